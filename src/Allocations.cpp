@@ -0,0 +1,207 @@
+/**
+ * @file Allocations.cpp
+ *
+ * @brief Counts of the heap allocations, per frame and per tag.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "Allocations.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	// Zero initialized before any constructor runs, so usable by the first operator new
+	struct AtomicCounts {
+		std::atomic<uint64_t> allocations;
+		std::atomic<uint64_t> bytes;
+		std::atomic<uint64_t> frees;
+	};
+
+	struct TagSlot {
+		std::atomic<const char*> name;
+		AtomicCounts counts;
+	};
+
+	AtomicCounts totalCounts;
+	TagSlot tags[Allocations::MaxTags];
+	std::atomic<int> usedTags;
+
+	Allocations::Counts frameStart;
+	Allocations::Counts frameCounts;
+
+	thread_local const char* currentTag = nullptr;
+
+	Allocations::Counts load(const AtomicCounts& counts)
+	{
+		Allocations::Counts result;
+		result.allocations = counts.allocations.load(std::memory_order_relaxed);
+		result.bytes = counts.bytes.load(std::memory_order_relaxed);
+		result.frees = counts.frees.load(std::memory_order_relaxed);
+		return result;
+	}
+
+	// Tags are compared by address, they are string literals. Without
+	// allocating: a tag that does not fit in the table is counted in the last slot.
+	TagSlot& tagSlot(const char* name)
+	{
+		const int used = usedTags.load(std::memory_order_acquire);
+		for (int i = 0; i < used; ++i)
+		{
+			if (tags[i].name.load(std::memory_order_relaxed) == name)
+				return tags[i];
+		}
+
+		for (int i = used; i < Allocations::MaxTags; ++i)
+		{
+			const char* expected = nullptr;
+			if (tags[i].name.compare_exchange_strong(expected, name) || expected == name) {
+				int count = usedTags.load(std::memory_order_relaxed);
+				while (count < i + 1 && !usedTags.compare_exchange_weak(count, i + 1)) {}
+				return tags[i];
+			}
+		}
+		return tags[Allocations::MaxTags - 1];
+	}
+
+#ifdef ENABLE_ALLOCATION_TRACKING
+	// Only used by the replacements of operator new and delete below
+	void countAllocation(size_t size)
+	{
+		totalCounts.allocations.fetch_add(1, std::memory_order_relaxed);
+		totalCounts.bytes.fetch_add(size, std::memory_order_relaxed);
+
+		TagSlot& slot = tagSlot(currentTag ? currentTag : "untagged");
+		slot.counts.allocations.fetch_add(1, std::memory_order_relaxed);
+		slot.counts.bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void countFree()
+	{
+		totalCounts.frees.fetch_add(1, std::memory_order_relaxed);
+		TagSlot& slot = tagSlot(currentTag ? currentTag : "untagged");
+		slot.counts.frees.fetch_add(1, std::memory_order_relaxed);
+	}
+#endif
+}
+
+namespace Allocations
+{
+	bool enabled()
+	{
+#ifdef ENABLE_ALLOCATION_TRACKING
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	Counts total()
+	{
+		return load(totalCounts);
+	}
+
+	void endFrame()
+	{
+		const Counts now = total();
+		frameCounts.allocations = now.allocations - frameStart.allocations;
+		frameCounts.bytes = now.bytes - frameStart.bytes;
+		frameCounts.frees = now.frees - frameStart.frees;
+		frameStart = now;
+	}
+
+	Counts lastFrame()
+	{
+		return frameCounts;
+	}
+
+	int tagCount()
+	{
+		return usedTags.load(std::memory_order_acquire);
+	}
+
+	const char* tagName(int index)
+	{
+		return tags[index].name.load(std::memory_order_relaxed);
+	}
+
+	Counts tagCounts(int index)
+	{
+		return load(tags[index].counts);
+	}
+
+	Tag::Tag(const char* name) :
+		m_previous(currentTag)
+	{
+		currentTag = name;
+	}
+
+	Tag::~Tag()
+	{
+		currentTag = m_previous;
+	}
+}
+
+#ifdef ENABLE_ALLOCATION_TRACKING
+void* operator new(size_t size)
+{
+	countAllocation(size);
+	if (void* memory = std::malloc(size ? size : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	countAllocation(size);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* memory) noexcept
+{
+	if (!memory)
+		return;
+	countFree();
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	operator delete(memory);
+}
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+/**
+ * @file Allocations.h
+ *
+ * @brief Counts of the heap allocations, per frame and per tag.
+ *
+ * When compiled with ENABLE_ALLOCATION_TRACKING (CMake option of the same
+ * name), the global operator new and delete are replaced by versions that
+ * count every allocation, charged to the innermost ALLOCATION_TAG of the
+ * thread. Otherwise nothing is counted and the macro expands to nothing.
+ * Allocations that bypass operator new (malloc, over-aligned new) are not
+ * seen.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <cstdint>
+
+namespace Allocations
+{
+	struct Counts {
+		uint64_t allocations = 0;
+		uint64_t bytes = 0;
+		uint64_t frees = 0;
+	};
+
+	static const int MaxTags = 64;
+
+	// Whether operator new is replaced
+	bool enabled();
+
+	// Every thread since the start of the program
+	Counts total();
+
+	// Counts between the last two calls of endFrame()
+	void endFrame();
+	Counts lastFrame();
+
+	// Tags seen so far with their counts since the start of the program.
+	// Allocations outside of any tag are under "untagged".
+	int tagCount();
+	const char* tagName(int index);
+	Counts tagCounts(int index);
+
+	// Charge the allocations of this thread to name until the end of the scope
+	class Tag {
+	public:
+		explicit Tag(const char* name);
+		~Tag();
+
+		Tag(const Tag&) = delete;
+		Tag& operator=(const Tag&) = delete;
+
+	private:
+		const char* m_previous;
+	};
+}
+
+#ifdef ENABLE_ALLOCATION_TRACKING
+#define ALLOCATION_TAG_CONCAT_IMPL(a, b) a##b
+#define ALLOCATION_TAG_CONCAT(a, b) ALLOCATION_TAG_CONCAT_IMPL(a, b)
+#define ALLOCATION_TAG(name) const Allocations::Tag ALLOCATION_TAG_CONCAT(allocationTag, __LINE__)(name)
+#else
+#define ALLOCATION_TAG(name)
+#endif
+#endif
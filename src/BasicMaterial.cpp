@@ -9,6 +9,7 @@
  */
 
 #include "BasicMaterial.h"
+#include "GLState.h"
 
 #include <glad/glad.h>
 #include <iostream>
@@ -19,10 +20,7 @@ BasicMaterial::BasicMaterial() : Material()
 
 void BasicMaterial::bind() const
 {
-	if (m_wireframe)
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	else 
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	GLState::polygonMode(m_wireframe ? GL_LINE : GL_FILL);
 
 	Material::bind();
 }
@@ -37,11 +35,6 @@ GLint BasicMaterial::normalAttribLocation() const
 	return GLint(-1);
 }
 
-void BasicMaterial::setColor(const glm::vec3& color)
-{
-	m_shaderProgram->setVec3(uColorAttributeName, color);
-}
-
 void BasicMaterial::setWireframe(bool value)
 {
 	m_wireframe = value;
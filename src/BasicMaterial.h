@@ -22,7 +22,7 @@ public:
 	virtual GLint positionAttribLocation() const override;
 	virtual GLint normalAttribLocation() const override;
 
-	void setColor(const glm::vec3& color);
+	// The color is the diffuse one of the material instances (see MaterialTable)
 	void setWireframe(bool value);
 
 protected:
@@ -35,7 +35,6 @@ private:
 	int m_vPositionLocation = -1;
 
 	const std::string vPositionAttributeName = "vPosition";
-	const std::string uColorAttributeName = "uColor";
 
 	bool m_wireframe = false;
 };
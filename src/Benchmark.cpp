@@ -0,0 +1,158 @@
+/**
+ * @file Benchmark.cpp
+ *
+ * @brief Results of the benchmark mode, written as JSON or CSV.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "Benchmark.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+	// Nearest rank percentile of sorted samples
+	double percentile(const std::vector<double>& sorted, double fraction)
+	{
+		const size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+		return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+	}
+
+	std::string escapeJson(const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\')
+				escaped += '\\';
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	void writeJsonSummary(std::ostream& out, const char* name, const BenchmarkReport::Summary& summary)
+	{
+		out << "\"" << name << "\": {\"count\": " << summary.count << ", \"min\": " << summary.min << ", \"mean\": " << summary.mean
+			<< ", \"p50\": " << summary.p50 << ", \"p90\": " << summary.p90 << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << "}";
+	}
+}
+
+BenchmarkReport::Summary BenchmarkReport::summarize(std::vector<double> samples)
+{
+	Summary summary;
+	if (samples.empty())
+		return summary;
+
+	std::sort(samples.begin(), samples.end());
+	summary.count = samples.size();
+	summary.min = samples.front();
+	summary.max = samples.back();
+	summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+	summary.p50 = percentile(samples, 0.50);
+	summary.p90 = percentile(samples, 0.90);
+	summary.p99 = percentile(samples, 0.99);
+	return summary;
+}
+
+void BenchmarkReport::setEnvironment(const std::string& renderer, int width, int height, int frames, int warmupFrames)
+{
+	m_renderer = renderer;
+	m_cores = std::thread::hardware_concurrency();
+	m_width = width;
+	m_height = height;
+	m_frames = frames;
+	m_warmupFrames = warmupFrames;
+}
+
+void BenchmarkReport::add(const Configuration& configuration, const std::vector<double>& generation, const std::vector<double>& upload,
+	const std::vector<double>& cpuFrame, const std::vector<double>& gpuFrame)
+{
+	Result result;
+	result.configuration = configuration;
+	result.generation = summarize(generation);
+	result.upload = summarize(upload);
+	result.cpuFrame = summarize(cpuFrame);
+	result.gpuFrame = summarize(gpuFrame);
+	m_results.push_back(result);
+}
+
+bool BenchmarkReport::write(const std::string& path) const
+{
+	const size_t extension = path.find_last_of('.');
+	if (extension != std::string::npos && path.substr(extension) == ".csv")
+		return writeCsv(path);
+	return writeJson(path);
+}
+
+bool BenchmarkReport::writeJson(const std::string& path) const
+{
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "Unable to open " << path << std::endl;
+		return false;
+	}
+
+	out << "{\n";
+	out << "  \"renderer\": \"" << escapeJson(m_renderer) << "\",\n";
+	out << "  \"cores\": " << m_cores << ",\n";
+	out << "  \"simd\": \"" << simdPathName() << "\",\n";
+	out << "  \"width\": " << m_width << ",\n";
+	out << "  \"height\": " << m_height << ",\n";
+	out << "  \"frames\": " << m_frames << ",\n";
+	out << "  \"warmup_frames\": " << m_warmupFrames << ",\n";
+	out << "  \"unit\": \"ms\",\n";
+	out << "  \"results\": [\n";
+	for (size_t i = 0; i < m_results.size(); ++i)
+	{
+		const Result& result = m_results[i];
+		out << "    {\"longitude\": " << result.configuration.longitude << ", \"latitude\": " << result.configuration.latitude
+			<< ", \"triangles\": " << result.configuration.triangles << ", \"material\": \"" << result.configuration.material
+			<< "\", \"lighting\": \"" << result.configuration.lighting << "\",\n     ";
+		writeJsonSummary(out, "generation", result.generation);
+		out << ",\n     ";
+		writeJsonSummary(out, "upload", result.upload);
+		out << ",\n     ";
+		writeJsonSummary(out, "cpu_frame", result.cpuFrame);
+		out << ",\n     ";
+		writeJsonSummary(out, "gpu_frame", result.gpuFrame);
+		out << "}" << (i + 1 < m_results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+	return static_cast<bool>(out);
+}
+
+bool BenchmarkReport::writeCsv(const std::string& path) const
+{
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "Unable to open " << path << std::endl;
+		return false;
+	}
+
+	// One row per measure, times in milliseconds
+	out << "longitude,latitude,triangles,material,lighting,measure,count,min,mean,p50,p90,p99,max\n";
+	for (const Result& result : m_results)
+	{
+		const std::pair<const char*, const Summary*> measures[] = {
+			{ "generation", &result.generation }, { "upload", &result.upload },
+			{ "cpu_frame", &result.cpuFrame }, { "gpu_frame", &result.gpuFrame }
+		};
+		for (const auto& measure : measures)
+		{
+			const Summary& summary = *measure.second;
+			out << result.configuration.longitude << "," << result.configuration.latitude << "," << result.configuration.triangles << ","
+				<< result.configuration.material << "," << result.configuration.lighting << "," << measure.first << ","
+				<< summary.count << "," << summary.min << "," << summary.mean << "," << summary.p50 << ","
+				<< summary.p90 << "," << summary.p99 << "," << summary.max << "\n";
+		}
+	}
+	return static_cast<bool>(out);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/**
+ * @file Benchmark.h
+ *
+ * @brief Results of the benchmark mode, written as JSON or CSV.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class BenchmarkReport {
+public:
+	// Statistics of a series of measures, in milliseconds
+	struct Summary {
+		size_t count = 0;
+		double min = 0.0;
+		double mean = 0.0;
+		double p50 = 0.0;
+		double p90 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	struct Configuration {
+		int longitude = 0;
+		int latitude = 0;
+		int triangles = 0;
+		std::string material;
+		std::string lighting;
+	};
+
+	static Summary summarize(std::vector<double> samples);
+
+	// Description of the machine and settings, written once at the top
+	void setEnvironment(const std::string& renderer, int width, int height, int frames, int warmupFrames);
+	void add(const Configuration& configuration, const std::vector<double>& generation, const std::vector<double>& upload,
+		const std::vector<double>& cpuFrame, const std::vector<double>& gpuFrame);
+
+	// CSV when the path ends with .csv, JSON otherwise. return true if sucessfull
+	bool write(const std::string& path) const;
+
+private:
+	struct Result {
+		Configuration configuration;
+		Summary generation;
+		Summary upload;
+		Summary cpuFrame;
+		Summary gpuFrame;
+	};
+
+	bool writeJson(const std::string& path) const;
+	bool writeCsv(const std::string& path) const;
+
+	std::string m_renderer;
+	unsigned int m_cores = 0;
+	int m_width = 0;
+	int m_height = 0;
+	int m_frames = 0;
+	int m_warmupFrames = 0;
+	std::vector<Result> m_results;
+};
+#endif
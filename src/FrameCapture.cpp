@@ -0,0 +1,192 @@
+/**
+ * @file FrameCapture.cpp
+ *
+ * @brief Saves rendered frames to images without stalling the rendering.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "FrameCapture.h"
+#include "GLState.h"
+#include "Image.h"
+
+#include <cstring>
+#include <iostream>
+
+// Longest wait for a fence when a slot must be reused, in nanoseconds
+static const GLuint64 FenceTimeout = 1000000000;
+
+FrameCapture::FrameCapture(unsigned int encoderThreads) :
+	m_encoders(encoderThreads)
+{
+	// Enough frames in flight to keep every encoder busy
+	m_maxEncodes = 2 * m_encoders.threadCount() + RingSize;
+}
+
+FrameCapture::~FrameCapture()
+{
+	// The OpenGL objects are released by finish(), which needs the context
+	m_encoders.wait();
+}
+
+void FrameCapture::capture(const std::string& path, int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return;
+	if ((width != m_width || height != m_height) && !resize(width, height)) {
+		++m_failedCount;
+		return;
+	}
+
+	// Every buffer is in use, the oldest read has to be done before reusing it
+	if (m_pending == RingSize) {
+		retrieve(m_slots[m_oldest], true);
+		m_oldest = (m_oldest + 1) % RingSize;
+		--m_pending;
+	}
+
+	Slot& slot = m_slots[(m_oldest + m_pending) % RingSize];
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO.id());
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.path = path;
+	// The fence is polled without flushing, make sure it reaches the GPU
+	glFlush();
+
+	++m_pending;
+	++m_capturedCount;
+}
+
+void FrameCapture::update()
+{
+	while (m_pending > 0 && retrieve(m_slots[m_oldest], false)) {
+		m_oldest = (m_oldest + 1) % RingSize;
+		--m_pending;
+	}
+}
+
+void FrameCapture::finish()
+{
+	while (m_pending > 0) {
+		retrieve(m_slots[m_oldest], true);
+		m_oldest = (m_oldest + 1) % RingSize;
+		--m_pending;
+	}
+	m_encoders.wait();
+
+	for (Slot& slot : m_slots)
+		slot.PBO.reset();
+	m_width = 0;
+	m_height = 0;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_freeBuffers.clear();
+}
+
+bool FrameCapture::resize(int width, int height)
+{
+	// Frames already read keep their size
+	update();
+	while (m_pending > 0) {
+		retrieve(m_slots[m_oldest], true);
+		m_oldest = (m_oldest + 1) % RingSize;
+		--m_pending;
+	}
+
+	m_oldest = 0;
+
+	const GLsizeiptr size = static_cast<GLsizeiptr>(width) * height * 4;
+	for (Slot& slot : m_slots) {
+		if (!slot.PBO)
+			slot.PBO = GpuHandle::create(GpuResourceType::Buffer, "FrameCapture", "pixel pack buffer");
+		if (!slot.PBO.setBytes(static_cast<size_t>(size))) {
+			for (Slot& other : m_slots)
+				other.PBO.reset();
+			m_width = 0;
+			m_height = 0;
+			return false;
+		}
+		GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO.id());
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+	}
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_width = width;
+	m_height = height;
+	return true;
+}
+
+bool FrameCapture::retrieve(Slot& slot, bool wait)
+{
+	GLenum status = glClientWaitSync(slot.fence, 0, 0);
+	while (wait && status == GL_TIMEOUT_EXPIRED)
+		status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FenceTimeout);
+	if (status == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+
+	const size_t size = static_cast<size_t>(m_width) * m_height * 4;
+	std::unique_ptr<std::vector<uint8_t>> pixels = acquireBuffer();
+	pixels->resize(size);
+
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, slot.PBO.id());
+	const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT);
+	if (data) {
+		std::memcpy(pixels->data(), data, size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (!data) {
+		std::cerr << "Unable to map the capture of " << slot.path << std::endl;
+		++m_failedCount;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_freeBuffers.push_back(std::move(pixels));
+		--m_encoding;
+		m_encodeDone.notify_all();
+		return true;
+	}
+
+	// std::function must be copyable, the job takes ownership of the raw buffer
+	std::vector<uint8_t>* buffer = pixels.release();
+	const std::string path = slot.path;
+	const int width = m_width;
+	const int height = m_height;
+	m_encoders.submit([this, buffer, path, width, height]() {
+		if (writeImage(path, width, height, buffer->data(), true)) {
+			++m_writtenCount;
+		}
+		else {
+			std::cerr << "Failed to write " << path << std::endl;
+			++m_failedCount;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_freeBuffers.emplace_back(buffer);
+		--m_encoding;
+		m_encodeDone.notify_all();
+	});
+	return true;
+}
+
+std::unique_ptr<std::vector<uint8_t>> FrameCapture::acquireBuffer()
+{
+	// Slow down the capture rather than piling up frames in memory
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_encodeDone.wait(lock, [this]() { return m_encoding < m_maxEncodes; });
+	++m_encoding;
+
+	if (m_freeBuffers.empty())
+		return std::make_unique<std::vector<uint8_t>>();
+
+	std::unique_ptr<std::vector<uint8_t>> buffer = std::move(m_freeBuffers.back());
+	m_freeBuffers.pop_back();
+	return buffer;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+/**
+ * @file FrameCapture.h
+ *
+ * @brief Saves rendered frames to images without stalling the rendering.
+ *
+ * Each capture reads the framebuffer into one of a ring of pixel pack
+ * buffers and inserts a fence. The buffer is only mapped once its fence is
+ * signaled, usually a frame or two later, and the pixels are then encoded
+ * by worker threads.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "GpuResources.h"
+#include "ThreadPool.h"
+
+class FrameCapture {
+public:
+	static const int RingSize = 3;
+
+	// Encoder threads, 0 uses one per hardware core
+	explicit FrameCapture(unsigned int encoderThreads = 0);
+	~FrameCapture();
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// Queue a read of the framebuffer bound for reading. Image format is chosen from the extension of the path.
+	void capture(const std::string& path, int width, int height);
+	// Hand the reads that are done over to the encoders, without waiting (call once per frame)
+	void update();
+	// Wait until every captured frame is written, frees the buffers
+	void finish();
+
+	inline size_t capturedCount() const { return m_capturedCount; }
+	inline size_t writtenCount() const { return m_writtenCount; }
+	inline size_t failedCount() const { return m_failedCount; }
+
+private:
+	struct Slot {
+		GpuHandle PBO;
+		GLsync fence = nullptr;
+		std::string path;
+	};
+
+	// return false when the buffers do not fit in the GPU budget
+	bool resize(int width, int height);
+	// Map the slot, block if its fence is not signaled yet when wait is set
+	bool retrieve(Slot& slot, bool wait);
+	std::unique_ptr<std::vector<uint8_t>> acquireBuffer();
+
+	Slot m_slots[RingSize];
+	int m_oldest = 0;  // Slot read the longest time ago
+	int m_pending = 0; // Slots waiting for their fence
+	int m_width = 0;
+	int m_height = 0;
+
+	ThreadPool m_encoders;
+	size_t m_maxEncodes;
+
+	// Pixel buffers handed over to the encoders, reused between frames
+	std::mutex m_mutex;
+	std::condition_variable m_encodeDone;
+	std::vector<std::unique_ptr<std::vector<uint8_t>>> m_freeBuffers;
+	size_t m_encoding = 0;
+
+	size_t m_capturedCount = 0;
+	std::atomic<size_t> m_writtenCount{ 0 };
+	std::atomic<size_t> m_failedCount{ 0 };
+};
+#endif
@@ -0,0 +1,84 @@
+/**
+ * @file FrameHistogram.cpp
+ *
+ * @brief Distribution of frame times over the whole run, in fixed memory.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "FrameHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+void FrameHistogram::add(double milliseconds)
+{
+	const uint64_t microseconds = static_cast<uint64_t>(std::max(0.0, std::round(milliseconds * 1000.0)));
+	m_buckets[bucketIndex(microseconds)].fetch_add(1, std::memory_order_relaxed);
+	m_totalMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+
+	uint64_t previous = m_maxMicroseconds.load(std::memory_order_relaxed);
+	while (microseconds > previous && !m_maxMicroseconds.compare_exchange_weak(previous, microseconds, std::memory_order_relaxed)) {}
+
+	// Last, so a reader never sees more frames than bucket counts
+	m_count.fetch_add(1, std::memory_order_release);
+}
+
+uint64_t FrameHistogram::count() const
+{
+	return m_count.load(std::memory_order_acquire);
+}
+
+double FrameHistogram::mean() const
+{
+	const uint64_t frames = count();
+	return frames > 0 ? static_cast<double>(m_totalMicroseconds.load(std::memory_order_relaxed)) / 1000.0 / static_cast<double>(frames) : 0.0;
+}
+
+double FrameHistogram::max() const
+{
+	return static_cast<double>(m_maxMicroseconds.load(std::memory_order_relaxed)) / 1000.0;
+}
+
+double FrameHistogram::percentile(double fraction) const
+{
+	const uint64_t frames = count();
+	if (frames == 0)
+		return 0.0;
+
+	const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(frames))));
+	uint64_t seen = 0;
+	for (int i = 0; i < BucketCount; ++i)
+	{
+		seen += m_buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank)
+			return static_cast<double>(std::min(bucketUpperBound(i), m_maxMicroseconds.load(std::memory_order_relaxed))) / 1000.0;
+	}
+	return max();
+}
+
+int FrameHistogram::bucketIndex(uint64_t microseconds)
+{
+	if (microseconds < SubBucketCount)
+		return static_cast<int>(microseconds);
+
+	// Power of two of the value, then its next SubBucketBits bits
+	int octave = 0;
+	while ((microseconds >> (octave + 1)) != 0)
+		++octave;
+	const int shift = octave - SubBucketBits;
+	const int subBucket = static_cast<int>((microseconds >> shift) & (SubBucketCount - 1));
+	return std::min(BucketCount - 1, SubBucketCount + shift * SubBucketCount + subBucket);
+}
+
+uint64_t FrameHistogram::bucketUpperBound(int index)
+{
+	if (index < SubBucketCount)
+		return static_cast<uint64_t>(index);
+
+	const int shift = (index - SubBucketCount) / SubBucketCount;
+	const uint64_t subBucket = static_cast<uint64_t>((index - SubBucketCount) % SubBucketCount);
+	return ((SubBucketCount + subBucket + 1) << shift) - 1;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#ifndef FRAMEHISTOGRAM_H
+#define FRAMEHISTOGRAM_H
+
+/**
+ * @file FrameHistogram.h
+ *
+ * @brief Distribution of frame times over the whole run, in fixed memory.
+ *
+ * Durations are counted in log-linear buckets of microseconds: exact below
+ * 16 us, then 16 buckets per power of two, so a percentile is off by less
+ * than 1/16 of its value. Counters are atomics, frames can be added by the
+ * rendering thread while another thread reads the percentiles.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class FrameHistogram {
+public:
+	static const int SubBucketBits = 4;
+	static const int SubBucketCount = 1 << SubBucketBits;
+	// Up to 2^40 us (about 12 days), longer frames go in the last bucket
+	static const int BucketCount = SubBucketCount + (40 - SubBucketBits) * SubBucketCount;
+
+	FrameHistogram() = default;
+
+	FrameHistogram(const FrameHistogram&) = delete;
+	FrameHistogram& operator=(const FrameHistogram&) = delete;
+
+	void add(double milliseconds);
+
+	uint64_t count() const;
+	double mean() const;
+	double max() const;
+	// Upper bound of the bucket holding the nearest rank, 0 when empty.
+	// fraction is in [0, 1], e.g. 0.999 for p99.9
+	double percentile(double fraction) const;
+
+private:
+	static int bucketIndex(uint64_t microseconds);
+	static uint64_t bucketUpperBound(int index);
+
+	std::atomic<uint64_t> m_buckets[BucketCount] = {};
+	std::atomic<uint64_t> m_count{ 0 };
+	std::atomic<uint64_t> m_totalMicroseconds{ 0 };
+	std::atomic<uint64_t> m_maxMicroseconds{ 0 };
+};
+#endif
@@ -0,0 +1,104 @@
+/**
+ * @file FrameTimings.cpp
+ *
+ * @brief Frame time percentiles and detection of the frames over budget.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "FrameTimings.h"
+
+#include <algorithm>
+
+FrameTimings::Subsystem FrameTimings::Stutter::longest() const
+{
+	return static_cast<Subsystem>(std::max_element(sections, sections + SubsystemCount) - sections);
+}
+
+FrameTimings::Section::Section(FrameTimings& timings, Subsystem subsystem) :
+	m_timings(timings), m_parent(timings.m_current)
+{
+	m_timings.charge(Clock::now());
+	m_timings.m_current = subsystem;
+}
+
+FrameTimings::Section::~Section()
+{
+	m_timings.charge(Clock::now());
+	m_timings.m_current = m_parent;
+}
+
+FrameTimings::FrameTimings(double budgetMilliseconds) :
+	m_budget(budgetMilliseconds)
+{
+}
+
+void FrameTimings::nextFrame(double milliseconds)
+{
+	const Clock::time_point now = Clock::now();
+	if (m_started)
+	{
+		charge(now);
+		m_histogram.add(milliseconds);
+
+		if (milliseconds > m_budget)
+		{
+			Stutter& stutter = m_stutters[m_nextStutter];
+			stutter.frame = m_frame;
+			stutter.milliseconds = milliseconds;
+			std::copy(m_sections, m_sections + SubsystemCount, stutter.sections);
+			m_nextStutter = (m_nextStutter + 1) % StutterCount;
+			++m_stutterTotal;
+		}
+		++m_frame;
+	}
+
+	m_started = true;
+	m_mark = now;
+	std::fill(m_sections, m_sections + SubsystemCount, 0.0);
+}
+
+int FrameTimings::stutterCount() const
+{
+	return static_cast<int>(std::min<uint64_t>(m_stutterTotal, StutterCount));
+}
+
+const FrameTimings::Stutter& FrameTimings::stutter(int index) const
+{
+	return m_stutters[(m_nextStutter - 1 - index + 2 * StutterCount) % StutterCount];
+}
+
+const char* FrameTimings::subsystemName(Subsystem subsystem)
+{
+	switch (subsystem)
+	{
+	case Subsystem::Other:
+		return "other";
+	case Subsystem::Input:
+		return "input";
+	case Subsystem::Update:
+		return "update";
+	case Subsystem::Geometry:
+		return "geometry rebuild";
+	case Subsystem::Scene:
+		return "scene";
+	case Subsystem::Capture:
+		return "capture";
+	case Subsystem::Interface:
+		return "interface";
+	case Subsystem::Present:
+		return "present";
+	case Subsystem::ShaderCompile:
+		return "shader compile";
+	default:
+		return "";
+	}
+}
+
+void FrameTimings::charge(Clock::time_point now)
+{
+	m_sections[static_cast<int>(m_current)] += std::chrono::duration<double, std::milli>(now - m_mark).count();
+	m_mark = now;
+}
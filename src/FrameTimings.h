@@ -0,0 +1,96 @@
+#pragma once
+#ifndef FRAMETIMINGS_H
+#define FRAMETIMINGS_H
+
+/**
+ * @file FrameTimings.h
+ *
+ * @brief Frame time percentiles and detection of the frames over budget.
+ *
+ * The frame is split in sections of the subsystems (input, geometry
+ * rebuild, scene, ...). Time is charged to the innermost open section, so
+ * the sections of a frame add up to the whole frame. When a frame goes over
+ * the budget, its sections are kept as a stutter to show which subsystem ran
+ * long.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "FrameHistogram.h"
+
+#include <chrono>
+#include <cstdint>
+
+class FrameTimings {
+public:
+	// ShaderCompile is the wait for the shaders of a material variant (see Material::finishInit)
+	enum class Subsystem { Other, Input, Update, Geometry, Scene, Capture, Interface, Present, ShaderCompile, Count };
+	static const int SubsystemCount = static_cast<int>(Subsystem::Count);
+	static const int StutterCount = 16;
+
+	// A frame over budget, section times in milliseconds
+	struct Stutter {
+		uint64_t frame = 0;
+		double milliseconds = 0.0;
+		double sections[SubsystemCount] = {};
+
+		Subsystem longest() const;
+	};
+
+	// Time of a subsystem until the end of the scope
+	class Section {
+	public:
+		Section(FrameTimings& timings, Subsystem subsystem);
+		~Section();
+
+		Section(const Section&) = delete;
+		Section& operator=(const Section&) = delete;
+
+	private:
+		FrameTimings& m_timings;
+		Subsystem m_parent;
+	};
+
+	explicit FrameTimings(double budgetMilliseconds = 1000.0 / 60.0);
+
+	FrameTimings(const FrameTimings&) = delete;
+	FrameTimings& operator=(const FrameTimings&) = delete;
+
+	// Ends the current frame, which lasted the given time (the first call only
+	// starts a frame), and starts the next one
+	void nextFrame(double milliseconds);
+
+	inline void setBudget(double milliseconds) { m_budget = milliseconds; }
+	inline double budget() const { return m_budget; }
+	inline const FrameHistogram& histogram() const { return m_histogram; }
+
+	// Frames over budget since the start
+	inline uint64_t stutterTotal() const { return m_stutterTotal; }
+	// Latest stutters, index 0 is the most recent one
+	int stutterCount() const;
+	const Stutter& stutter(int index) const;
+
+	static const char* subsystemName(Subsystem subsystem);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// Charge the time since the last change to the current section
+	void charge(Clock::time_point now);
+
+	double m_budget;
+	FrameHistogram m_histogram;
+	uint64_t m_frame = 0;
+	bool m_started = false;
+
+	Subsystem m_current = Subsystem::Other;
+	Clock::time_point m_mark;
+	double m_sections[SubsystemCount] = {};
+
+	Stutter m_stutters[StutterCount];
+	int m_nextStutter = 0;
+	uint64_t m_stutterTotal = 0;
+};
+#endif
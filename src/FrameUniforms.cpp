@@ -0,0 +1,40 @@
+/**
+ * @file FrameUniforms.cpp
+ *
+ * @brief Uniform buffer with the camera of the frame, shared by every program.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "FrameUniforms.h"
+#include "GLState.h"
+#include "RenderStats.h"
+
+bool FrameUniforms::create()
+{
+	m_buffer = GpuHandle::create(GpuResourceType::Buffer, "FrameUniforms", "uniform buffer");
+	if (!m_buffer.setBytes(sizeof(Block))) {
+		m_buffer.reset();
+		return false;
+	}
+	glNamedBufferStorage(m_buffer.id(), sizeof(Block), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	GLState::bindBufferBase(GL_UNIFORM_BUFFER, BindingPoint, m_buffer.id());
+	return true;
+}
+
+void FrameUniforms::update(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPosition)
+{
+	if (!m_buffer)
+		return;
+
+	const Block block = { projection, view, glm::vec4(viewPosition, 1.0f) };
+	glNamedBufferSubData(m_buffer.id(), 0, sizeof(Block), &block);
+	RenderStats::current().bufferBytes += sizeof(Block);
+}
+
+void FrameUniforms::destroy()
+{
+	m_buffer.reset();
+}
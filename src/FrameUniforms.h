@@ -0,0 +1,59 @@
+#pragma once
+#ifndef FRAMEUNIFORMS_H
+#define FRAMEUNIFORMS_H
+
+/**
+ * @file FrameUniforms.h
+ *
+ * @brief Uniform buffer with the camera of the frame, shared by every program.
+ *
+ * The shaders declare the block as
+ *
+ *     layout(std140) uniform Frame { mat4 projection; mat4 view; vec3 viewPos; };
+ *
+ * and Material::init() attaches it to BindingPoint. The buffer stays bound
+ * there, so the camera is written once per frame whatever the number of
+ * materials, and switching material keeps it.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GpuResources.h"
+
+class FrameUniforms {
+public:
+	static constexpr const char* BlockName = "Frame";
+	static const GLuint BindingPoint = 0;
+
+	FrameUniforms() = default;
+
+	FrameUniforms(const FrameUniforms&) = delete;
+	FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+	// Allocate the buffer and bind it to BindingPoint, needs a current context.
+	// return false when it does not fit in the GPU budget
+	bool create();
+
+	// Write the camera of the frame
+	void update(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPosition);
+
+	// Release the buffer, needs the context to be current
+	void destroy();
+
+private:
+	// std140 layout of the block, a vec3 takes the room of a vec4
+	struct Block {
+		glm::mat4 projection;
+		glm::mat4 view;
+		glm::vec4 viewPosition;
+	};
+	static_assert(sizeof(Block) == 144, "Block must match the std140 layout of Frame");
+
+	GpuHandle m_buffer;
+};
+#endif
@@ -0,0 +1,77 @@
+/**
+ * @file Framebuffer.cpp
+ *
+ * @brief Offscreen render target with a color and a depth attachment.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "Framebuffer.h"
+#include "GLState.h"
+
+#include <iostream>
+
+bool Framebuffer::create(int width, int height)
+{
+	destroy();
+	m_width = width;
+	m_height = height;
+
+	// Drivers store 24 bits depth in 32 bits
+	const size_t bytes = static_cast<size_t>(width) * height * 4;
+	m_colorRBO = GpuHandle::create(GpuResourceType::Renderbuffer, "Framebuffer", "color target");
+	m_depthRBO = GpuHandle::create(GpuResourceType::Renderbuffer, "Framebuffer", "depth target");
+	if (!m_colorRBO.setBytes(bytes) || !m_depthRBO.setBytes(bytes)) {
+		destroy();
+		return false;
+	}
+
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorRBO.id());
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthRBO.id());
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	m_FBO = GpuHandle::create(GpuResourceType::Framebuffer, "Framebuffer", "framebuffer");
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, m_FBO.id());
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorRBO.id());
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRBO.id());
+
+	const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Framebuffer incomplete (0x" << std::hex << status << std::dec << ")" << std::endl;
+		destroy();
+		return false;
+	}
+
+	return true;
+}
+
+void Framebuffer::destroy()
+{
+	m_FBO.reset();
+	m_colorRBO.reset();
+	m_depthRBO.reset();
+}
+
+void Framebuffer::bind() const
+{
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, m_FBO.id());
+	GLState::viewport(0, 0, m_width, m_height);
+}
+
+void Framebuffer::bindDefault()
+{
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::readPixels(std::vector<uint8_t>& outPixels) const
+{
+	outPixels.resize(static_cast<size_t>(m_width) * m_height * 4);
+	GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, m_FBO.id());
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, outPixels.data());
+}
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+/**
+ * @file Framebuffer.h
+ *
+ * @brief Offscreen render target with a color and a depth attachment.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glad/glad.h>
+
+#include "GpuResources.h"
+
+#include <cstdint>
+#include <vector>
+
+class Framebuffer {
+public:
+	Framebuffer() = default;
+
+	Framebuffer(const Framebuffer&) = delete;
+	Framebuffer& operator=(const Framebuffer&) = delete;
+
+	// RGBA8 color and 24 bits depth, return true if sucessfull
+	bool create(int width, int height);
+	// The objects are also released by the destructor, the context must still be current
+	void destroy();
+
+	// Bind for drawing and set the viewport to the whole target
+	void bind() const;
+	static void bindDefault();
+
+	// RGBA8 pixels, rows from bottom to top (OpenGL order)
+	void readPixels(std::vector<uint8_t>& outPixels) const;
+
+	inline GLuint id() const { return m_FBO.id(); }
+	inline int width() const { return m_width; }
+	inline int height() const { return m_height; }
+
+private:
+	GpuHandle m_FBO;
+	GpuHandle m_colorRBO;
+	GpuHandle m_depthRBO;
+	int m_width = 0;
+	int m_height = 0;
+};
+#endif
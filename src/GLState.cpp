@@ -0,0 +1,218 @@
+/**
+ * @file GLState.cpp
+ *
+ * @brief Cache of the OpenGL bindings and fixed function state.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "GLState.h"
+#include "RenderStats.h"
+
+#include <cstdint>
+
+namespace
+{
+	// Value of a state that may be anything
+	const GLuint Unknown = 0xFFFFFFFFu;
+
+	enum BufferTarget { ArrayBuffer, ElementArrayBuffer, UniformBuffer, PixelPackBuffer, BufferTargetCount };
+
+	// Capabilities the engine changes, the others are not cached
+	const GLenum Capabilities[] = { GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_SCISSOR_TEST, GL_STENCIL_TEST };
+	const int CapabilityCount = sizeof(Capabilities) / sizeof(Capabilities[0]);
+
+	struct State {
+		GLuint program = Unknown;
+		GLuint vertexArray = Unknown;
+		GLuint buffers[BufferTargetCount] = { Unknown, Unknown, Unknown, Unknown };
+		GLuint drawFramebuffer = Unknown;
+		GLuint readFramebuffer = Unknown;
+		GLuint polygonMode = Unknown;
+		GLuint capabilities[CapabilityCount] = { Unknown, Unknown, Unknown, Unknown, Unknown };
+		GLint viewport[4] = { -1, -1, -1, -1 };
+	};
+
+	State state;
+
+	int bufferTarget(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_ARRAY_BUFFER:
+			return ArrayBuffer;
+		case GL_ELEMENT_ARRAY_BUFFER:
+			return ElementArrayBuffer;
+		case GL_UNIFORM_BUFFER:
+			return UniformBuffer;
+		case GL_PIXEL_PACK_BUFFER:
+			return PixelPackBuffer;
+		default:
+			return -1;
+		}
+	}
+
+	int capabilityIndex(GLenum capability)
+	{
+		for (int i = 0; i < CapabilityCount; ++i)
+		{
+			if (Capabilities[i] == capability)
+				return i;
+		}
+		return -1;
+	}
+
+	// Update the cached value, return false when it already had it
+	bool change(GLuint& cached, GLuint value)
+	{
+		if (cached == value) {
+			++RenderStats::current().redundantStates;
+			return false;
+		}
+		cached = value;
+		return true;
+	}
+
+	void setCapability(GLenum capability, bool enabled)
+	{
+		const int index = capabilityIndex(capability);
+		if (index >= 0 && !change(state.capabilities[index], enabled ? 1 : 0))
+			return;
+
+		if (enabled)
+			glEnable(capability);
+		else
+			glDisable(capability);
+		++RenderStats::current().stateChanges;
+	}
+}
+
+namespace GLState
+{
+	void useProgram(GLuint program)
+	{
+		if (!change(state.program, program))
+			return;
+		glUseProgram(program);
+		++RenderStats::current().programBinds;
+	}
+
+	void bindVertexArray(GLuint vertexArray)
+	{
+		if (!change(state.vertexArray, vertexArray))
+			return;
+		glBindVertexArray(vertexArray);
+		// The index buffer binding is part of the vertex array
+		state.buffers[ElementArrayBuffer] = Unknown;
+		++RenderStats::current().vaoBinds;
+	}
+
+	void bindBuffer(GLenum target, GLuint buffer)
+	{
+		const int index = bufferTarget(target);
+		if (index >= 0 && !change(state.buffers[index], buffer))
+			return;
+		glBindBuffer(target, buffer);
+	}
+
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+	{
+		glBindBufferBase(target, index, buffer);
+		const int cached = bufferTarget(target);
+		if (cached >= 0)
+			state.buffers[cached] = buffer;
+	}
+
+	void bindFramebuffer(GLenum target, GLuint framebuffer)
+	{
+		if (target == GL_FRAMEBUFFER) {
+			if (state.drawFramebuffer == framebuffer && state.readFramebuffer == framebuffer) {
+				++RenderStats::current().redundantStates;
+				return;
+			}
+			state.drawFramebuffer = framebuffer;
+			state.readFramebuffer = framebuffer;
+		}
+		else if (!change(target == GL_READ_FRAMEBUFFER ? state.readFramebuffer : state.drawFramebuffer, framebuffer)) {
+			return;
+		}
+		glBindFramebuffer(target, framebuffer);
+	}
+
+	void polygonMode(GLenum mode)
+	{
+		if (!change(state.polygonMode, mode))
+			return;
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+		++RenderStats::current().stateChanges;
+	}
+
+	void enable(GLenum capability)
+	{
+		setCapability(capability, true);
+	}
+
+	void disable(GLenum capability)
+	{
+		setCapability(capability, false);
+	}
+
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		GLint* cached = state.viewport;
+		if (cached[0] == x && cached[1] == y && cached[2] == width && cached[3] == height) {
+			++RenderStats::current().redundantStates;
+			return;
+		}
+		cached[0] = x;
+		cached[1] = y;
+		cached[2] = width;
+		cached[3] = height;
+		glViewport(x, y, width, height);
+	}
+
+	GLuint currentProgram()
+	{
+		return state.program == Unknown ? 0 : state.program;
+	}
+
+	void invalidate()
+	{
+		state = State();
+	}
+
+	void forget(GpuResourceType type, GLuint id)
+	{
+		// OpenGL unbinds a deleted object, a new one with the same name is not bound
+		switch (type)
+		{
+		case GpuResourceType::Program:
+			if (state.program == id)
+				state.program = Unknown;
+			break;
+		case GpuResourceType::VertexArray:
+			if (state.vertexArray == id) {
+				state.vertexArray = Unknown;
+				state.buffers[ElementArrayBuffer] = Unknown;
+			}
+			break;
+		case GpuResourceType::Buffer:
+			for (GLuint& buffer : state.buffers)
+			{
+				if (buffer == id)
+					buffer = Unknown;
+			}
+			break;
+		case GpuResourceType::Framebuffer:
+			if (state.drawFramebuffer == id)
+				state.drawFramebuffer = Unknown;
+			if (state.readFramebuffer == id)
+				state.readFramebuffer = Unknown;
+			break;
+		default:
+			break;
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+/**
+ * @file GLState.h
+ *
+ * @brief Cache of the OpenGL bindings and fixed function state.
+ *
+ * The engine changes the program, vertex array, buffer and framebuffer
+ * bindings, the polygon mode, the enabled capabilities and the viewport
+ * through these functions. A change to the value the context already has is
+ * filtered out and counted in RenderStats::redundantStates.
+ *
+ * Code that changes the state behind the cache (the ImGui backend, a new
+ * context) must be followed by invalidate(), the next change of each state
+ * then always reaches OpenGL. Deleted objects are forgotten by GpuHandle.
+ * Only the thread of the context may use it.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glad/glad.h>
+
+#include "GpuResources.h"
+
+namespace GLState
+{
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+	// GL_ELEMENT_ARRAY_BUFFER belongs to the vertex array, bind the vertex array first
+	void bindBuffer(GLenum target, GLuint buffer);
+	// Indexed binding, also changes the binding of the target like OpenGL does
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	// GL_FRAMEBUFFER binds both the draw and read framebuffers
+	void bindFramebuffer(GLenum target, GLuint framebuffer);
+	// Same mode for GL_FRONT_AND_BACK, the only one of the core profile
+	void polygonMode(GLenum mode);
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+	// Program in use, 0 when none or unknown
+	GLuint currentProgram();
+
+	// Forget every state, they are unknown until changed again
+	void invalidate();
+	// An object is deleted, its name can be reused by the next one created
+	void forget(GpuResourceType type, GLuint id);
+}
+#endif
@@ -0,0 +1,251 @@
+/**
+ * @file GeometryBenchmark.cpp
+ *
+ * @brief Throughput of the sphere mesh generation, without OpenGL.
+ *
+ * Every generation path of SphereGeometry is measured for a few resolutions
+ * and thread counts. Each measure is repeated after some warmup runs and
+ * reported as a mean with its standard deviation.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "Simd.h"
+#include "SphereGeometry.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct Settings {
+		int warmup = 3;
+		int repetitions = 10;
+		std::string csv;
+	};
+
+	// Mean and standard deviation of a rate, in items per second
+	struct Rate {
+		double mean = 0.0;
+		double deviation = 0.0;
+
+		inline double variation() const { return mean > 0.0 ? deviation / mean : 0.0; }
+	};
+
+	struct Result {
+		int resolution = 0;
+		const char* path = "";
+		unsigned int threads = 0;
+		Rate vertices;
+		Rate indices;
+		Rate bytes;
+	};
+
+	const int Resolutions[] = { 16, 64, 256, 1024 };
+	const SphereGeometry::Path Paths[] = { SphereGeometry::Path::Reference, SphereGeometry::Path::Scalar, SphereGeometry::Path::Simd };
+
+	bool parseInt(const char* text, int& outValue)
+	{
+		char* end = nullptr;
+		const long value = std::strtol(text, &end, 10);
+		if (end == text || *end != '\0')
+			return false;
+		outValue = static_cast<int>(value);
+		return true;
+	}
+
+	// return true if sucessfull, errors are written on std::cerr
+	bool parseSettings(int argc, char* argv[], Settings& outSettings)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string name = argv[i];
+			if (name == "--help" || name == "-h")
+				return false;
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value for " << name << std::endl;
+				return false;
+			}
+			const char* value = argv[++i];
+
+			bool valid = true;
+			if (name == "--warmup")
+				valid = parseInt(value, outSettings.warmup) && outSettings.warmup >= 0;
+			else if (name == "--repetitions")
+				valid = parseInt(value, outSettings.repetitions) && outSettings.repetitions > 1;
+			else if (name == "--csv")
+				outSettings.csv = value;
+			else {
+				std::cerr << "Unknown option " << name << std::endl;
+				return false;
+			}
+
+			if (!valid) {
+				std::cerr << "Invalid value '" << value << "' for " << name << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	Rate rate(const std::vector<double>& seconds, double items)
+	{
+		Rate result;
+		std::vector<double> rates;
+		rates.reserve(seconds.size());
+		for (double duration : seconds)
+			rates.push_back(items / std::max(duration, 1e-9));
+
+		for (double value : rates)
+			result.mean += value;
+		result.mean /= static_cast<double>(rates.size());
+
+		double variance = 0.0;
+		for (double value : rates)
+			variance += (value - result.mean) * (value - result.mean);
+		result.deviation = std::sqrt(variance / static_cast<double>(rates.size() - 1));
+		return result;
+	}
+
+	// The optimized paths must give the same mesh as the reference one
+	bool matches(const SphereMesh& reference, const SphereMesh& mesh)
+	{
+		if (reference.indices != mesh.indices || reference.vertices.size() != mesh.vertices.size())
+			return false;
+		for (size_t i = 0; i < reference.vertices.size(); ++i)
+		{
+			if (std::fabs(reference.vertices[i] - mesh.vertices[i]) > 1e-5f || std::fabs(reference.normals[i] - mesh.normals[i]) > 1e-5f)
+				return false;
+		}
+		return true;
+	}
+
+	std::vector<unsigned int> threadCounts()
+	{
+		const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<unsigned int> counts;
+		for (unsigned int count = 1; count < cores; count *= 2)
+			counts.push_back(count);
+		counts.push_back(cores);
+		return counts;
+	}
+
+	void printRate(const char* unit, const Rate& rate)
+	{
+		std::printf("  %s %10.2f M/s +- %6.2f (cv %4.1f%%)", unit, rate.mean * 1e-6, rate.deviation * 1e-6, 100.0 * rate.variation());
+	}
+
+	bool writeCsv(const std::string& path, const std::vector<Result>& results)
+	{
+		std::ofstream file(path);
+		if (!file) {
+			std::cerr << "Unable to open " << path << std::endl;
+			return false;
+		}
+
+		file << "resolution,path,threads,vertices_per_s,vertices_stddev,indices_per_s,indices_stddev,bytes_per_s,bytes_stddev\n";
+		for (const Result& result : results)
+		{
+			file << result.resolution << ',' << result.path << ',' << result.threads << ','
+				<< result.vertices.mean << ',' << result.vertices.deviation << ','
+				<< result.indices.mean << ',' << result.indices.deviation << ','
+				<< result.bytes.mean << ',' << result.bytes.deviation << '\n';
+		}
+		return static_cast<bool>(file);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Settings settings;
+	if (!parseSettings(argc, argv, settings)) {
+		std::cerr << "Usage: " << argv[0] << " [options]\n"
+			<< "  --warmup <count>       Runs ignored before measuring (3)\n"
+			<< "  --repetitions <count>  Measured runs per configuration, at least 2 (10)\n"
+			<< "  --csv <file>           Also write the results as CSV\n";
+		return EXIT_FAILURE;
+	}
+
+	std::printf("SIMD: %s, %d floats wide, %u hardware threads\n", simdPathName(), SimdFloat::Width, std::thread::hardware_concurrency());
+	std::printf("%d warmup runs, %d repetitions\n\n", settings.warmup, settings.repetitions);
+
+	using Clock = std::chrono::steady_clock;
+	const std::vector<unsigned int> counts = threadCounts();
+	std::vector<Result> results;
+	bool valid = true;
+
+	for (int resolution : Resolutions)
+	{
+		const SphereGeometry geometry(1.0f, resolution, resolution);
+		SphereMesh reference;
+		geometry.generate(reference, SphereGeometry::Path::Reference);
+
+		const double vertexTotal = static_cast<double>(reference.vertexCount());
+		const double indexTotal = static_cast<double>(reference.indices.size());
+		const double byteTotal = sizeof(float) * static_cast<double>(reference.vertices.size() + reference.normals.size())
+			+ sizeof(uint32_t) * indexTotal;
+
+		for (SphereGeometry::Path path : Paths)
+		{
+			for (unsigned int threads : counts)
+			{
+				// The reference version is single threaded
+				if (path == SphereGeometry::Path::Reference && threads > 1)
+					continue;
+
+				// The calling thread works too, ThreadPool(0) would mean every core
+				std::unique_ptr<ThreadPool> pool;
+				if (threads > 1)
+					pool = std::make_unique<ThreadPool>(threads - 1);
+
+				// A new mesh each run, allocating it is part of the generation
+				std::vector<double> seconds;
+				for (int run = 0; run < settings.warmup + settings.repetitions; ++run)
+				{
+					SphereMesh mesh;
+					const auto start = Clock::now();
+					geometry.generate(mesh, path, pool.get());
+					const double duration = std::chrono::duration<double>(Clock::now() - start).count();
+
+					if (run >= settings.warmup)
+						seconds.push_back(duration);
+					if (run == 0 && !matches(reference, mesh)) {
+						std::cerr << SphereGeometry::pathName(path) << " differs from the reference at " << resolution << std::endl;
+						valid = false;
+					}
+				}
+
+				Result result;
+				result.resolution = resolution;
+				result.path = SphereGeometry::pathName(path);
+				result.threads = threads;
+				result.vertices = rate(seconds, vertexTotal);
+				result.indices = rate(seconds, indexTotal);
+				result.bytes = rate(seconds, byteTotal);
+				results.push_back(result);
+
+				std::printf("%4dx%-4d %-9s %2u thread(s)", resolution, resolution, result.path, threads);
+				printRate("vertices", result.vertices);
+				printRate("indices", result.indices);
+				printRate("bytes", result.bytes);
+				std::printf("\n");
+			}
+		}
+	}
+
+	if (!settings.csv.empty() && !writeCsv(settings.csv, results))
+		return EXIT_FAILURE;
+	return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file GpuProfiler.cpp
+ *
+ * @brief Rolling GPU and CPU timings of the render passes of a frame.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+void GpuProfiler::begin(Pass pass)
+{
+	PassTimings& timings = m_passes[static_cast<int>(pass)];
+	timings.start = std::chrono::steady_clock::now();
+	timings.timer.begin();
+}
+
+void GpuProfiler::end(Pass pass)
+{
+	PassTimings& timings = m_passes[static_cast<int>(pass)];
+	timings.timer.end();
+	timings.cpu.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - timings.start).count());
+}
+
+void GpuProfiler::update()
+{
+	for (PassTimings& timings : m_passes)
+	{
+		bool changed = false;
+		double milliseconds = 0.0;
+		while (timings.timer.poll(milliseconds)) {
+			timings.gpu.add(milliseconds);
+			changed = true;
+		}
+
+		if (changed)
+			timings.gpu.summarize(m_scratch);
+		timings.cpu.summarize(m_scratch);
+	}
+}
+
+const char* GpuProfiler::passName(Pass pass)
+{
+	switch (pass)
+	{
+	case Pass::Scene:
+		return "Scene";
+	case Pass::Interface:
+		return "Interface";
+	default:
+		return "";
+	}
+}
+
+void GpuProfiler::destroy()
+{
+	for (PassTimings& timings : m_passes)
+		timings.timer.destroy();
+}
+
+void GpuProfiler::Window::add(double milliseconds)
+{
+	samples[next] = milliseconds;
+	next = (next + 1) % WindowSize;
+	if (count < WindowSize)
+		++count;
+	statistics.last = milliseconds;
+}
+
+void GpuProfiler::Window::summarize(double* scratch)
+{
+	statistics.count = static_cast<size_t>(count);
+	if (count == 0)
+		return;
+
+	// The ring is full or filled from the start, its order does not matter here
+	std::copy(samples, samples + count, scratch);
+	double sum = 0.0;
+	for (int i = 0; i < count; ++i)
+		sum += scratch[i];
+	statistics.average = sum / count;
+	statistics.min = *std::min_element(scratch, scratch + count);
+
+	// Nearest rank, like BenchmarkReport::summarize
+	const int rank = std::max(1, static_cast<int>(std::ceil(0.99 * count)));
+	std::nth_element(scratch, scratch + rank - 1, scratch + count);
+	statistics.p99 = scratch[rank - 1];
+}
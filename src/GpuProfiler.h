@@ -0,0 +1,82 @@
+#pragma once
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+/**
+ * @file GpuProfiler.h
+ *
+ * @brief Rolling GPU and CPU timings of the render passes of a frame.
+ *
+ * Each pass has its own GpuTimer, results are collected by update() once
+ * they are available, a few frames later, so the rendering never waits for
+ * them. The CPU time spent submitting the pass is kept next to the GPU one
+ * to tell whether a pass is limited by the submission or by the GPU.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "GpuTimer.h"
+
+#include <chrono>
+#include <cstddef>
+
+class GpuProfiler {
+public:
+	enum class Pass { Scene, Interface, Count };
+
+	// Over the last WindowSize frames, in milliseconds
+	struct Statistics {
+		size_t count = 0;
+		double last = 0.0;
+		double min = 0.0;
+		double average = 0.0;
+		double p99 = 0.0;
+	};
+
+	static const int WindowSize = 240;
+	static const int PassCount = static_cast<int>(Pass::Count);
+
+	GpuProfiler() = default;
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	// Passes can not overlap (GL_TIME_ELAPSED queries do not nest)
+	void begin(Pass pass);
+	void end(Pass pass);
+
+	// Collect the finished queries and update the statistics, once per frame
+	void update();
+
+	inline const Statistics& gpuStatistics(Pass pass) const { return m_passes[static_cast<int>(pass)].gpu.statistics; }
+	inline const Statistics& cpuStatistics(Pass pass) const { return m_passes[static_cast<int>(pass)].cpu.statistics; }
+	static const char* passName(Pass pass);
+
+	// Release the queries, needs the context to be current
+	void destroy();
+
+private:
+	// Last WindowSize samples, without allocations
+	struct Window {
+		double samples[WindowSize] = {};
+		int next = 0;
+		int count = 0;
+		Statistics statistics;
+
+		void add(double milliseconds);
+		void summarize(double* scratch);
+	};
+
+	struct PassTimings {
+		GpuTimer timer;
+		std::chrono::steady_clock::time_point start;
+		Window gpu;
+		Window cpu;
+	};
+
+	PassTimings m_passes[PassCount];
+	double m_scratch[WindowSize] = {};
+};
+#endif
@@ -0,0 +1,287 @@
+/**
+ * @file GpuResources.cpp
+ *
+ * @brief Ownership and memory accounting of the OpenGL objects.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "GpuResources.h"
+#include "GLState.h"
+
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+	void deleteObject(GpuResourceType type, GLuint id)
+	{
+		switch (type)
+		{
+		case GpuResourceType::Buffer:
+			glDeleteBuffers(1, &id);
+			break;
+		case GpuResourceType::VertexArray:
+			glDeleteVertexArrays(1, &id);
+			break;
+		case GpuResourceType::Program:
+			glDeleteProgram(id);
+			break;
+		case GpuResourceType::Shader:
+			glDeleteShader(id);
+			break;
+		case GpuResourceType::Texture:
+			glDeleteTextures(1, &id);
+			break;
+		case GpuResourceType::Renderbuffer:
+			glDeleteRenderbuffers(1, &id);
+			break;
+		case GpuResourceType::Framebuffer:
+			glDeleteFramebuffers(1, &id);
+			break;
+		case GpuResourceType::Query:
+			glDeleteQueries(1, &id);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void printUsage(std::ostream& out, const std::string& name, const GpuResourceRegistry::Usage& usage)
+	{
+		out << "  " << std::left << std::setw(28) << name << std::right << std::setw(6) << usage.count << " objects "
+			<< std::setw(12) << usage.bytes << " bytes (peak " << usage.peakBytes << ")\n";
+	}
+}
+
+GpuHandle::GpuHandle(GpuResourceType type, GLuint id, const char* owner, const char* category) :
+	m_id(id)
+{
+	if (m_id)
+		m_entry = GpuResourceRegistry::instance().add(type, id, owner, category);
+}
+
+GpuHandle::~GpuHandle()
+{
+	reset();
+}
+
+GpuHandle GpuHandle::create(GpuResourceType type, const char* owner, const char* category)
+{
+	GLuint id = 0;
+	switch (type)
+	{
+	// Created, not only named, so that direct state access can use them right away
+	case GpuResourceType::Buffer:
+		glCreateBuffers(1, &id);
+		break;
+	case GpuResourceType::VertexArray:
+		glCreateVertexArrays(1, &id);
+		break;
+	case GpuResourceType::Program:
+		id = glCreateProgram();
+		break;
+	case GpuResourceType::Texture:
+		glGenTextures(1, &id);
+		break;
+	case GpuResourceType::Renderbuffer:
+		glGenRenderbuffers(1, &id);
+		break;
+	case GpuResourceType::Framebuffer:
+		glGenFramebuffers(1, &id);
+		break;
+	case GpuResourceType::Query:
+		glGenQueries(1, &id);
+		break;
+	default:
+		std::cerr << "Use GpuHandle::createShader for shaders" << std::endl;
+		break;
+	}
+	return GpuHandle(type, id, owner, category);
+}
+
+GpuHandle GpuHandle::createShader(GLenum shaderType, const char* owner)
+{
+	return GpuHandle(GpuResourceType::Shader, glCreateShader(shaderType), owner, "shader");
+}
+
+GpuHandle::GpuHandle(GpuHandle&& other) noexcept :
+	m_id(other.m_id), m_entry(other.m_entry)
+{
+	other.m_id = 0;
+	other.m_entry = 0;
+}
+
+GpuHandle& GpuHandle::operator=(GpuHandle&& other) noexcept
+{
+	if (this != &other) {
+		reset();
+		m_id = other.m_id;
+		m_entry = other.m_entry;
+		other.m_id = 0;
+		other.m_entry = 0;
+	}
+	return *this;
+}
+
+bool GpuHandle::setBytes(size_t bytes)
+{
+	return m_entry != 0 && GpuResourceRegistry::instance().resize(m_entry - 1, bytes);
+}
+
+size_t GpuHandle::bytes() const
+{
+	return m_entry != 0 ? GpuResourceRegistry::instance().m_entries[m_entry - 1].bytes : 0;
+}
+
+void GpuHandle::reset()
+{
+	if (m_entry != 0)
+		GpuResourceRegistry::instance().remove(m_entry - 1);
+	m_id = 0;
+	m_entry = 0;
+}
+
+GpuResourceRegistry& GpuResourceRegistry::instance()
+{
+	static GpuResourceRegistry registry;
+	return registry;
+}
+
+void GpuResourceRegistry::contextCreated()
+{
+	m_contextAlive = true;
+}
+
+void GpuResourceRegistry::contextDestroyed()
+{
+	if (!m_contextAlive)
+		return;
+	m_contextAlive = false;
+
+	// Whatever is still alive was never released
+	size_t leaks = 0;
+	for (Entry& entry : m_entries)
+	{
+		if (!entry.alive || entry.leaked)
+			continue;
+		if (leaks++ == 0)
+			std::cerr << "GPU objects still alive when the context is destroyed:" << std::endl;
+		std::cerr << "  " << entry.owner << " " << entry.category << " (" << typeName(entry.type) << " " << entry.id << ", "
+			<< entry.bytes << " bytes)" << std::endl;
+		entry.leaked = true;
+	}
+	m_leakCount += leaks;
+}
+
+bool GpuResourceRegistry::fits(size_t releasedBytes, size_t addedBytes) const
+{
+	return m_budget == 0 || m_total.bytes - releasedBytes + addedBytes <= m_budget;
+}
+
+void GpuResourceRegistry::report(std::ostream& out) const
+{
+	out << "GPU objects per owner:\n";
+	for (const auto& owner : m_owners)
+		printUsage(out, owner.first, owner.second);
+	out << "GPU objects per category:\n";
+	for (const auto& category : m_categories)
+		printUsage(out, category.first, category.second);
+	printUsage(out, "Total", m_total);
+	if (m_budget > 0)
+		out << "  Budget " << m_budget << " bytes\n";
+	if (m_leakCount > 0)
+		out << "  " << m_leakCount << " objects leaked\n";
+}
+
+const char* GpuResourceRegistry::typeName(GpuResourceType type)
+{
+	switch (type)
+	{
+	case GpuResourceType::Buffer:
+		return "buffer";
+	case GpuResourceType::VertexArray:
+		return "vertex array";
+	case GpuResourceType::Program:
+		return "program";
+	case GpuResourceType::Shader:
+		return "shader";
+	case GpuResourceType::Texture:
+		return "texture";
+	case GpuResourceType::Renderbuffer:
+		return "renderbuffer";
+	case GpuResourceType::Framebuffer:
+		return "framebuffer";
+	case GpuResourceType::Query:
+		return "query";
+	default:
+		return "";
+	}
+}
+
+uint32_t GpuResourceRegistry::add(GpuResourceType type, GLuint id, const char* owner, const char* category)
+{
+	uint32_t index;
+	if (!m_freeEntries.empty()) {
+		index = m_freeEntries.back();
+		m_freeEntries.pop_back();
+	}
+	else {
+		index = static_cast<uint32_t>(m_entries.size());
+		m_entries.emplace_back();
+	}
+
+	Entry& entry = m_entries[index];
+	entry = Entry();
+	entry.type = type;
+	entry.id = id;
+	entry.owner = owner;
+	entry.category = category;
+	entry.alive = true;
+	account(entry, 1, 0);
+	return index + 1;
+}
+
+bool GpuResourceRegistry::resize(uint32_t index, size_t bytes)
+{
+	Entry& entry = m_entries[index];
+	if (bytes > entry.bytes && !fits(entry.bytes, bytes)) {
+		std::cerr << entry.owner << " " << entry.category << " of " << bytes << " bytes would go over the GPU budget ("
+			<< m_total.bytes - entry.bytes << " of " << m_budget << " bytes used)" << std::endl;
+		return false;
+	}
+
+	const size_t previous = entry.bytes;
+	entry.bytes = bytes;
+	account(entry, 0, previous);
+	return true;
+}
+
+void GpuResourceRegistry::remove(uint32_t index)
+{
+	Entry& entry = m_entries[index];
+	if (!entry.leaked && m_contextAlive) {
+		GLState::forget(entry.type, entry.id);
+		deleteObject(entry.type, entry.id);
+	}
+
+	const size_t previous = entry.bytes;
+	entry.bytes = 0;
+	account(entry, -1, previous);
+	entry.alive = false;
+	m_freeEntries.push_back(index);
+}
+
+void GpuResourceRegistry::account(const Entry& entry, int countChange, size_t previousBytes)
+{
+	Usage* usages[] = { &m_total, &m_owners[entry.owner], &m_categories[entry.category] };
+	for (Usage* usage : usages)
+	{
+		usage->count = static_cast<size_t>(static_cast<long long>(usage->count) + countChange);
+		usage->bytes = usage->bytes - previousBytes + entry.bytes;
+		if (usage->bytes > usage->peakBytes)
+			usage->peakBytes = usage->bytes;
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+#ifndef GPURESOURCES_H
+#define GPURESOURCES_H
+
+/**
+ * @file GpuResources.h
+ *
+ * @brief Ownership and memory accounting of the OpenGL objects.
+ *
+ * Every OpenGL object is created through a GpuHandle, a move-only owner that
+ * deletes the object when it goes away. The registry knows every live
+ * object with its owner ("Sphere", "FrameCapture", ...), category ("vertex
+ * buffer", "color target", ...) and the bytes of its storage, and keeps the
+ * totals and high-water marks. Storage can be limited by a budget.
+ *
+ * Objects still alive when the context is destroyed are reported as leaks,
+ * their handles then only forget them (the names died with the context).
+ * Only the thread of the context may use the handles.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class GpuResourceType { Buffer, VertexArray, Program, Shader, Texture, Renderbuffer, Framebuffer, Query, Count };
+
+class GpuHandle {
+public:
+	GpuHandle() = default;
+	~GpuHandle();
+
+	// Create an object, needs a current context. Owner and category must be
+	// string literals (or outlive the handle)
+	static GpuHandle create(GpuResourceType type, const char* owner, const char* category);
+	static GpuHandle createShader(GLenum shaderType, const char* owner);
+
+	GpuHandle(GpuHandle&& other) noexcept;
+	GpuHandle& operator=(GpuHandle&& other) noexcept;
+	GpuHandle(const GpuHandle&) = delete;
+	GpuHandle& operator=(const GpuHandle&) = delete;
+
+	inline GLuint id() const { return m_id; }
+	inline explicit operator bool() const { return m_id != 0; }
+
+	// Size of the storage allocated for the object.
+	// return false, without changing it, when it would go over the budget
+	bool setBytes(size_t bytes);
+	size_t bytes() const;
+
+	// Delete the object now
+	void reset();
+
+private:
+	GpuHandle(GpuResourceType type, GLuint id, const char* owner, const char* category);
+
+	GLuint m_id = 0;
+	uint32_t m_entry = 0; // Index in the registry + 1, 0 when empty
+};
+
+class GpuResourceRegistry {
+public:
+	struct Usage {
+		size_t count = 0;
+		size_t bytes = 0;
+		size_t peakBytes = 0;
+	};
+
+	static GpuResourceRegistry& instance();
+
+	GpuResourceRegistry(const GpuResourceRegistry&) = delete;
+	GpuResourceRegistry& operator=(const GpuResourceRegistry&) = delete;
+
+	// Called by whoever creates and destroys the OpenGL context
+	void contextCreated();
+	void contextDestroyed();
+
+	// Bytes of storage allowed for all the objects, 0 for no limit
+	inline void setBudget(size_t bytes) { m_budget = bytes; }
+	inline size_t budget() const { return m_budget; }
+	// Whether replacing releasedBytes of storage by addedBytes stays in the budget
+	bool fits(size_t releasedBytes, size_t addedBytes) const;
+
+	inline const Usage& total() const { return m_total; }
+	inline const std::map<std::string, Usage>& owners() const { return m_owners; }
+	inline const std::map<std::string, Usage>& categories() const { return m_categories; }
+	inline size_t leakCount() const { return m_leakCount; }
+
+	// Usage per owner and category, then the totals
+	void report(std::ostream& out) const;
+
+	static const char* typeName(GpuResourceType type);
+
+private:
+	friend class GpuHandle;
+
+	struct Entry {
+		GpuResourceType type = GpuResourceType::Buffer;
+		GLuint id = 0;
+		const char* owner = "";
+		const char* category = "";
+		size_t bytes = 0;
+		bool alive = false;
+		bool leaked = false; // Its context is gone
+	};
+
+	GpuResourceRegistry() = default;
+
+	uint32_t add(GpuResourceType type, GLuint id, const char* owner, const char* category);
+	bool resize(uint32_t entry, size_t bytes);
+	void remove(uint32_t entry);
+	void account(const Entry& entry, int countChange, size_t previousBytes);
+
+	std::vector<Entry> m_entries;
+	std::vector<uint32_t> m_freeEntries;
+	bool m_contextAlive = false;
+	size_t m_budget = 0;
+	size_t m_leakCount = 0;
+
+	Usage m_total;
+	std::map<std::string, Usage> m_owners;
+	std::map<std::string, Usage> m_categories;
+};
+#endif
@@ -0,0 +1,96 @@
+/**
+ * @file GpuTimer.cpp
+ *
+ * @brief GPU duration of a section of commands, measured with timer queries.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "GpuTimer.h"
+
+void GpuTimer::begin()
+{
+	if (!m_created) {
+		for (GpuHandle& query : m_queries)
+			query = GpuHandle::create(GpuResourceType::Query, "GpuTimer", "timer query");
+		m_created = true;
+	}
+
+	// Every query is in flight, the oldest result has to be read first
+	if (m_pending == RingSize)
+		readOldest(true);
+
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[(m_oldest + m_pending) % RingSize].id());
+	m_running = true;
+}
+
+void GpuTimer::end()
+{
+	if (!m_running)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	m_running = false;
+	++m_pending;
+}
+
+bool GpuTimer::poll(double& outMilliseconds, bool wait)
+{
+	if (m_readyCount == 0 && !readOldest(wait))
+		return false;
+
+	outMilliseconds = m_ready[m_readyBegin];
+	m_readyBegin = (m_readyBegin + 1) % RingSize;
+	--m_readyCount;
+	return true;
+}
+
+void GpuTimer::destroy()
+{
+	for (GpuHandle& query : m_queries)
+		query.reset();
+	m_created = false;
+	m_oldest = 0;
+	m_pending = 0;
+	m_running = false;
+	m_measured = false;
+	m_readyCount = 0;
+}
+
+bool GpuTimer::readOldest(bool wait)
+{
+	if (m_pending == 0)
+		return false;
+
+	const GLuint query = m_queries[m_oldest].id();
+	if (!wait) {
+		GLint available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+	}
+
+	// Blocks until the result is there
+	GLuint64 nanoseconds = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+	m_oldest = (m_oldest + 1) % RingSize;
+	--m_pending;
+
+	// The first query of a timer can be meaningless, llvmpipe returns the
+	// time since the creation of the context for it
+	if (!m_measured) {
+		m_measured = true;
+		return readOldest(wait);
+	}
+
+	// Keep the latest results if they are never polled
+	if (m_readyCount == RingSize) {
+		m_readyBegin = (m_readyBegin + 1) % RingSize;
+		--m_readyCount;
+	}
+	m_ready[(m_readyBegin + m_readyCount) % RingSize] = static_cast<double>(nanoseconds) / 1e6;
+	++m_readyCount;
+	return true;
+}
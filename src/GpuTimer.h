@@ -0,0 +1,61 @@
+#pragma once
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+/**
+ * @file GpuTimer.h
+ *
+ * @brief GPU duration of a section of commands, measured with timer queries.
+ *
+ * The queries are kept in a ring and read a few frames later, when their
+ * result is available, so measuring never waits on the GPU unless more
+ * than RingSize sections are in flight.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glad/glad.h>
+
+#include "GpuResources.h"
+
+class GpuTimer {
+public:
+	static const int RingSize = 4;
+
+	GpuTimer() = default;
+
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	// Only one timer can be active at a time (GL_TIME_ELAPSED queries do not nest)
+	void begin();
+	void end();
+
+	// Take the oldest finished measure, in milliseconds. The first query of
+	// the timer is never returned, see readOldest.
+	// Waits for it when wait is set. return false if there is none.
+	bool poll(double& outMilliseconds, bool wait = false);
+	inline int pendingCount() const { return m_pending; }
+
+	// Release the queries, needs the context to be current
+	void destroy();
+
+private:
+	bool readOldest(bool wait);
+
+	GpuHandle m_queries[RingSize];
+	bool m_created = false;
+	int m_oldest = 0;
+	int m_pending = 0;
+	bool m_running = false;
+	// The first query was read (and dropped) since creation or destroy()
+	bool m_measured = false;
+
+	// Results read early because the ring was full, oldest first
+	double m_ready[RingSize] = {};
+	int m_readyBegin = 0;
+	int m_readyCount = 0;
+};
+#endif
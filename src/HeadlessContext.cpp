@@ -0,0 +1,155 @@
+/**
+ * @file HeadlessContext.cpp
+ *
+ * @brief OpenGL context that does not need a display.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "HeadlessContext.h"
+#include "GpuResources.h"
+
+#include <cstring>
+#include <iostream>
+
+#ifdef HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::~HeadlessContext()
+{
+	destroy();
+}
+
+bool HeadlessContext::create(int major, int minor, bool preferWindow)
+{
+	destroy();
+
+	if (preferWindow && createGLFW(major, minor)) {
+		m_api = "GLFW";
+	}
+	else if (createEGL(major, minor)) {
+		m_api = "EGL";
+	}
+	else if (!preferWindow && createGLFW(major, minor)) {
+		m_api = "GLFW";
+	}
+	else {
+		std::cerr << "Failed to create a headless OpenGL context" << std::endl;
+		return false;
+	}
+
+	GpuResourceRegistry::instance().contextCreated();
+	return true;
+}
+
+void HeadlessContext::destroy()
+{
+	if (std::strcmp(m_api, "none") != 0)
+		GpuResourceRegistry::instance().contextDestroyed();
+
+#ifdef HAS_EGL
+	if (m_eglDisplay) {
+		EGLDisplay display = static_cast<EGLDisplay>(m_eglDisplay);
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (m_eglContext)
+			eglDestroyContext(display, static_cast<EGLContext>(m_eglContext));
+		eglTerminate(display);
+		m_eglDisplay = nullptr;
+		m_eglContext = nullptr;
+	}
+#endif
+	if (m_window) {
+		glfwDestroyWindow(m_window);
+		glfwTerminate();
+		m_window = nullptr;
+	}
+	m_api = "none";
+}
+
+bool HeadlessContext::createEGL(int major, int minor)
+{
+#ifdef HAS_EGL
+	// Surfaceless platform first, it does not need any display server
+	EGLDisplay display = EGL_NO_DISPLAY;
+	auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (getPlatformDisplay)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+		return false;
+	m_eglDisplay = display;
+
+	const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+	if (!extensions || !std::strstr(extensions, "EGL_KHR_surfaceless_context") || !eglBindAPI(EGL_OPENGL_API)) {
+		destroy();
+		return false;
+	}
+
+	// Rendering goes to framebuffer objects, the config only matters for the API
+	EGLConfig config = nullptr;
+	if (!std::strstr(extensions, "EGL_KHR_no_config_context")) {
+		const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_NONE };
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+			destroy();
+			return false;
+		}
+	}
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, major,
+		EGL_CONTEXT_MINOR_VERSION, minor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT) {
+		destroy();
+		return false;
+	}
+	m_eglContext = context;
+
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)
+		|| !gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress))) {
+		destroy();
+		return false;
+	}
+	return true;
+#else
+	(void)major;
+	(void)minor;
+	return false;
+#endif
+}
+
+bool HeadlessContext::createGLFW(int major, int minor)
+{
+	if (!glfwInit())
+		return false;
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+	m_window = glfwCreateWindow(1, 1, "", nullptr, nullptr);
+	if (!m_window) {
+		glfwTerminate();
+		return false;
+	}
+
+	glfwMakeContextCurrent(m_window);
+	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+		destroy();
+		return false;
+	}
+	return true;
+}
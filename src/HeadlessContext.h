@@ -0,0 +1,55 @@
+#pragma once
+#ifndef HEADLESSCONTEXT_H
+#define HEADLESSCONTEXT_H
+
+/**
+ * @file HeadlessContext.h
+ *
+ * @brief OpenGL context that does not need a display.
+ *
+ * Uses a surfaceless EGL display when the program is built with EGL
+ * (HAS_EGL), which works on servers with Mesa's llvmpipe. Otherwise, or if
+ * EGL fails, falls back on a hidden GLFW window (GLFW can itself be built
+ * with GLFW_USE_OSMESA for machines without a display server).
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+class HeadlessContext {
+public:
+	HeadlessContext() = default;
+	~HeadlessContext();
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	// Create a core profile context, make it current and load OpenGL.
+	// preferWindow tries the hidden GLFW window before EGL, for the code
+	// that uses a window (ImGui)
+	// return true if sucessfull
+	bool create(int major, int minor, bool preferWindow = false);
+	void destroy();
+
+	// Name of the API used to create the context
+	inline const char* api() const { return m_api; }
+	// Hidden window of the GLFW fallback, null with EGL
+	inline GLFWwindow* window() const { return m_window; }
+
+private:
+	bool createEGL(int major, int minor);
+	bool createGLFW(int major, int minor);
+
+	const char* m_api = "none";
+
+#ifdef HAS_EGL
+	void* m_eglDisplay = nullptr;
+	void* m_eglContext = nullptr;
+#endif
+	GLFWwindow* m_window = nullptr;
+};
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file Image.cpp
+ *
+ * @brief Writing of RGBA8 images to disk.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "Image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <vector>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+bool writeImage(const std::string& path, int width, int height, const uint8_t* rgba, bool flipVertically)
+{
+	std::string extension = path.substr(path.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	// Start at the last row and use a negative stride to flip
+	const int stride = width * 4;
+	const uint8_t* data = flipVertically ? rgba + static_cast<size_t>(height - 1) * stride : rgba;
+
+	int success = 0;
+	if (extension == "png")
+	{
+		success = stbi_write_png(path.c_str(), width, height, 4, data, flipVertically ? -stride : stride);
+	}
+	else
+	{
+		// The other writers have no stride parameter, and their global flip
+		// flag is not thread safe: flip a copy instead
+		std::vector<uint8_t> flipped;
+		if (flipVertically)
+		{
+			flipped.resize(static_cast<size_t>(height) * stride);
+			for (int y = 0; y < height; ++y)
+				std::copy(data - static_cast<ptrdiff_t>(y) * stride, data - static_cast<ptrdiff_t>(y) * stride + stride, flipped.begin() + static_cast<size_t>(y) * stride);
+			rgba = flipped.data();
+		}
+
+		if (extension == "tga")
+			success = stbi_write_tga(path.c_str(), width, height, 4, rgba);
+		else if (extension == "bmp")
+			success = stbi_write_bmp(path.c_str(), width, height, 4, rgba);
+		else if (extension == "jpg" || extension == "jpeg")
+			success = stbi_write_jpg(path.c_str(), width, height, 4, rgba, 95);
+		else
+			std::cerr << "Unknown image format: " << path << std::endl;
+	}
+
+	if (!success)
+		std::cerr << "Unable to write image: " << path << std::endl;
+	return success != 0;
+}
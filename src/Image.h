@@ -0,0 +1,22 @@
+#pragma once
+#ifndef IMAGE_H
+#define IMAGE_H
+
+/**
+ * @file Image.h
+ *
+ * @brief Writing of RGBA8 images to disk.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <cstdint>
+#include <string>
+
+// Format chosen from the extension (.png, .tga, .bmp or .jpg).
+// Rows are given top to bottom unless flipVertically is set (OpenGL order).
+// return true if sucessfull
+bool writeImage(const std::string& path, int width, int height, const uint8_t* rgba, bool flipVertically = false);
+#endif
@@ -0,0 +1,104 @@
+/**
+ * @file InstanceBuffer.cpp
+ *
+ * @brief Vertex buffer with the model matrix and material of the instances drawn in a frame.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "InstanceBuffer.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Instances of the first buffer, it doubles when a frame outgrows it
+static const size_t InitialCapacity = 256;
+static const GLuint64 FenceTimeout = 1000000000;
+static const GLbitfield MapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+bool InstanceBuffer::upload(const std::vector<Instance>& instances)
+{
+	if ((instances.size() > m_capacity || !m_buffer) && !resize(std::max(InitialCapacity, 2 * instances.size())))
+		return false;
+
+	if (instances.empty())
+		return true;
+
+	// The draws of RegionCount frames ago may still read the region
+	m_region = (m_region + 1) % RegionCount;
+	GLsync& fence = m_fences[m_region];
+	if (fence) {
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		while (status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FenceTimeout);
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	const size_t bytes = instances.size() * sizeof(Instance);
+	std::memcpy(m_mapped + offset(), instances.data(), bytes);
+	RenderStats::current().bufferBytes += bytes;
+	return true;
+}
+
+void InstanceBuffer::fence()
+{
+	if (!m_mapped)
+		return;
+
+	GLsync& fence = m_fences[m_region];
+	if (fence)
+		glDeleteSync(fence);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void InstanceBuffer::destroy()
+{
+	releaseFences();
+	if (m_mapped)
+		glUnmapNamedBuffer(m_buffer.id());
+	m_mapped = nullptr;
+	m_buffer.reset();
+	m_capacity = 0;
+}
+
+bool InstanceBuffer::resize(size_t capacity)
+{
+	// The old buffer goes first, it does not count in the budget anymore
+	const size_t bytes = RegionCount * capacity * sizeof(Instance);
+	if (!GpuResourceRegistry::instance().fits(m_buffer.bytes(), bytes)) {
+		if (capacity != m_refusedCapacity)
+			std::cerr << "Instance buffer of " << bytes << " bytes is over the GPU budget, the spheres will not be drawn" << std::endl;
+		m_refusedCapacity = capacity;
+		return false;
+	}
+
+	// The draws still reading the old buffer keep its storage alive
+	destroy();
+	m_buffer = GpuHandle::create(GpuResourceType::Buffer, "InstanceBuffer", "vertex buffer");
+	m_buffer.setBytes(bytes);
+	glNamedBufferStorage(m_buffer.id(), static_cast<GLsizeiptr>(bytes), nullptr, MapFlags);
+	m_mapped = static_cast<uint8_t*>(glMapNamedBufferRange(m_buffer.id(), 0, static_cast<GLsizeiptr>(bytes), MapFlags));
+	if (!m_mapped) {
+		std::cerr << "Unable to map the instance buffer" << std::endl;
+		m_buffer.reset();
+		return false;
+	}
+	m_capacity = capacity;
+	m_region = 0;
+	return true;
+}
+
+void InstanceBuffer::releaseFences()
+{
+	for (GLsync& fence : m_fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef INSTANCEBUFFER_H
+#define INSTANCEBUFFER_H
+
+/**
+ * @file InstanceBuffer.h
+ *
+ * @brief Vertex buffer with the model matrix and material of the instances drawn in a frame.
+ *
+ * The instances are vertex attributes with a divisor of 1 (see
+ * Material::ModelLocation), a draw of several instances takes its range
+ * with the base instance. The RenderQueue writes the whole frame at once.
+ *
+ * The buffer is split in RegionCount regions, persistently mapped, used one
+ * frame after the other. A frame writes its region once the fence put after
+ * the draws that last read it is signaled, so the GPU never reads instances
+ * being overwritten and the CPU only waits when it is RegionCount frames ahead.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GpuResources.h"
+
+#include <cstdint>
+#include <vector>
+
+class InstanceBuffer {
+public:
+	struct Instance {
+		glm::mat4 model;
+		uint32_t material; // Index in the MaterialTable
+	};
+
+	InstanceBuffer() = default;
+
+	InstanceBuffer(const InstanceBuffer&) = delete;
+	InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+	static const int RegionCount = 3;
+
+	// Write the instances in the next region. A larger buffer is created when
+	// they do not fit. The meshes must take id() and offset() after every upload.
+	// return false, writing nothing, when the larger buffer is over the GPU budget
+	bool upload(const std::vector<Instance>& instances);
+	// Call after the draws reading the region of the last upload
+	void fence();
+	inline GLuint id() const { return m_buffer.id(); }
+	inline GLintptr offset() const { return static_cast<GLintptr>(m_region * m_capacity * sizeof(Instance)); }
+
+	// Release the buffer, needs the context to be current
+	void destroy();
+
+private:
+	// return false and keep the current buffer when it is over the GPU budget
+	bool resize(size_t capacity);
+	void releaseFences();
+
+	// Immutable storage, recreated larger when a frame outgrows it
+	GpuHandle m_buffer;
+	uint8_t* m_mapped = nullptr;
+	size_t m_capacity = 0; // Instances per region
+	size_t m_region = 0;   // Region of the last upload
+	size_t m_refusedCapacity = 0; // Last capacity over the budget, reported once
+	GLsync m_fences[RegionCount] = {};
+};
+#endif
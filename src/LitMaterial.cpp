@@ -9,6 +9,7 @@
  */
 
 #include "LitMaterial.h"
+#include "GLState.h"
 
 #include <glad/glad.h>
 #include <iostream>
@@ -19,7 +20,7 @@ LitMaterial::LitMaterial() : Material()
 
 void LitMaterial::bind() const
 {
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	GLState::polygonMode(GL_FILL);
 
 	Material::bind();
 }
@@ -35,26 +36,6 @@ GLint LitMaterial::normalAttribLocation() const
 	return m_vNormalLocation;
 }
 
-void LitMaterial::setAmbiantColor(const glm::vec3& color)
-{
-	m_shaderProgram->setVec3(uAmbiantColorAttributeName, color);
-}
-
-void LitMaterial::setDiffuseColor(const glm::vec3& color)
-{
-	m_shaderProgram->setVec3(uDiffuseColorAttributeName, color);
-}
-
-void LitMaterial::setSpecularColor(const glm::vec3& color)
-{
-	m_shaderProgram->setVec3(uSpecularColorAttributeName, color);
-}
-
-void LitMaterial::setSpecularExponent(float exponent)
-{
-	m_shaderProgram->setFloat(uSpecularExponentAttributeName, exponent);
-}
-
 void LitMaterial::setLightPosition(const glm::vec3& position)
 {
 	m_shaderProgram->setVec3(uLightPositionAttributeName, position);
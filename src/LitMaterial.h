@@ -22,17 +22,14 @@ public:
 	virtual GLint positionAttribLocation() const override;
 	virtual GLint normalAttribLocation() const override;
 
-	void setAmbiantColor(const glm::vec3& color);
-	void setDiffuseColor(const glm::vec3& color);
-	void setSpecularColor(const glm::vec3& color);
-	void setSpecularExponent(float exponent);
-
+	// The colors are the ones of the material instances (see MaterialTable)
 	void setLightPosition(const glm::vec3& position);
 	void setLightColor(const glm::vec4& color);
 
 
 protected:
 	virtual bool init_impl() override;
+	virtual uint32_t featureMask() const override { return Blinn; }
 
 	virtual inline std::string vertexShader() const override { return "litShader.vert"; }
 	virtual inline std::string fragmentShader() const override { return "litShader.frag"; }
@@ -44,12 +41,7 @@ private:
 	const std::string vPositionAttributeName = "vPosition";
 	const std::string vNormalAttributeName = "vNormal";
 
-	const std::string uAmbiantColorAttributeName = "uAmbiantColor";
-	const std::string uDiffuseColorAttributeName = "uDiffuseColor";
-	const std::string uSpecularColorAttributeName = "uSpecularColor";
-	const std::string uSpecularExponentAttributeName = "uSpecularExponent";
-
-	const std::string uLightPositionAttributeName = "uLightPosition";
-	const std::string uLightColorAttributeName = "uLightColor";
+	static constexpr UniformName uLightPositionAttributeName = "uLightPosition";
+	static constexpr UniformName uLightColorAttributeName = "uLightColor";
 };
 #endif
@@ -9,14 +9,60 @@
  */
 
 #include "MainWindow.h"
+#include "Options.h"
+#include "Profiler.h"
 
-int main()
+#include <iostream>
+
+namespace
 {
-	MainWindow MainWindow;
-	int init_value = MainWindow.initialisation();
-	if (init_value != 0) {
-		return init_value;
+	int run(MainWindow& mainWindow, const Options& options)
+	{
+		switch (options.mode)
+		{
+		case Options::Mode::Headless:
+			return mainWindow.renderHeadless(options.output, options.width, options.height, options.frames, options.frameTime);
+		case Options::Mode::Software:
+			return mainWindow.renderSoftware(options.output, options.width, options.height);
+		case Options::Mode::RayTrace:
+			return mainWindow.renderRayTraced(options.output, options.width, options.height, options.samples);
+		case Options::Mode::Benchmark:
+			return mainWindow.runBenchmark(options.output, options.width, options.height, options.benchmarkFrames, options.benchmarkWarmup);
+		case Options::Mode::CheckAllocations:
+			return mainWindow.checkAllocations(options.width, options.height, options.checkedFrames, options.checkWarmup);
+		case Options::Mode::Window:
+			break;
+		}
+
+		int init_value = mainWindow.initialisation();
+		if (init_value != 0) {
+			return init_value;
+		}
+
+		return mainWindow.renderLoop();
 	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+	if (options.help) {
+		printUsage(argv[0]);
+		return 0;
+	}
+
+	if (!options.trace.empty() && !Profiler::enabled())
+		std::cerr << "Profiling zones are not compiled in (ENABLE_PROFILER), no trace will be written" << std::endl;
+
+	MainWindow MainWindow;
+	MainWindow.applyOptions(options);
+	const int result = run(MainWindow, options);
 
-	return MainWindow.renderLoop();
-}
\ No newline at end of file
+	if (!options.trace.empty() && Profiler::enabled() && !Profiler::writeTrace(options.trace))
+		return 1;
+	return result;
+}
@@ -9,11 +9,29 @@
  */
 
 #include "MainWindow.h"
+#include "SoftwareRenderer.h"
+#include "RayTracer.h"
+#include "Image.h"
+#include "HeadlessContext.h"
+#include "Framebuffer.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "GpuResources.h"
+#include "Allocations.h"
+#include "GLState.h"
+#include "ProgramCache.h"
+#include "Benchmark.h"
+#include "ThreadPool.h"
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -26,16 +44,13 @@ MainWindow::MainWindow()
 
 int MainWindow::initialisation()
 {
-	// OpenGL version (usefull for imGUI and other libraries)
-	const char* glsl_version = "#version 430 core";
-
 	// glfw: initialize and configure
 	// ------------------------------
 	glfwInit();
 
-	// Request OpenGL 4.3
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	// Request OpenGL 4.5 (direct state access)
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, GLMajorVersion);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, GLMinorVersion);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
@@ -63,24 +78,44 @@ int MainWindow::initialisation()
 		std::cerr << "Failed to initialize GLAD" << std::endl;
 		return 2;
 	}
+	GpuResourceRegistry::instance().contextCreated();
 
 	// imGui: create interface
 	// ---------------------------------------
+	initializeImgui();
+
+	// Other openGL initialization
+	// -----------------------------
+	return initializeGL();
+}
+
+void MainWindow::initializeImgui()
+{
+	// OpenGL version (usefull for imGUI and other libraries)
+	const char* glsl_version = "#version 450 core";
+
 	// Setup Dear ImGui context
 	ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO(); (void)io;
-	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;// Enable Keyboard Controls
+	if (m_window)
+		io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;// Enable Keyboard Controls
 
 	// Setup Dear ImGui style
 	ImGui::StyleColorsDark();
 
-	// Setup Platform/Renderer backends
-	ImGui_ImplGlfw_InitForOpenGL(m_window, true);
+	// Setup Platform/Renderer backends. Without a window, renderImgui gives
+	// the size of the framebuffer and there is no input
+	if (m_window)
+		ImGui_ImplGlfw_InitForOpenGL(m_window, true);
 	ImGui_ImplOpenGL3_Init(glsl_version);
+}
 
-	// Other openGL initialization
-	// -----------------------------
-	return initializeGL();
+void MainWindow::releaseImgui()
+{
+	ImGui_ImplOpenGL3_Shutdown();
+	if (m_window)
+		ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
 }
 
 void MainWindow::initializeCallback() {
@@ -101,28 +136,138 @@ void MainWindow::initializeCallback() {
 
 int MainWindow::initializeGL()
 {
-	m_sphereMaterial = std::make_shared<BasicMaterial>();
-	if (!m_sphereMaterial->init()) {
-		return 3;
+	// Nothing is known of a new context
+	GLState::invalidate();
+	if (!m_frameUniforms.create() || !m_materialTable.create()) {
+		return 4;
 	}
 
+	// Every material compiles at the same time, only the one of the first
+	// frame is waited for, the others finish while rendering (see finishMaterials)
+	m_sphereMaterial = std::make_shared<BasicMaterial>();
 	m_sphereLitMaterial = std::make_shared<LitMaterial>();
-	if (!m_sphereLitMaterial->init()) {
+	// Variant of the first frame
+	m_sphereLitMaterial->setPhong(phong);
+	if (!m_sphereMaterial->beginInit() || !m_sphereLitMaterial->beginInit()) {
+		return 3;
+	}
+	if (!currentMaterial()->finishInit()) {
 		return 3;
 	}
 
-	m_sphere = std::make_unique<Sphere>(m_radius, m_longitude, m_latitude, m_sphereLitMaterial);
+	m_sphere = std::make_unique<Sphere>(m_radius, m_longitude, m_latitude);
+	initializeScene();
+	applyMaterialType();
 
-	glEnable(GL_DEPTH_TEST);
+	GLState::enable(GL_DEPTH_TEST);
 
 	return 0;
 }
 
+void MainWindow::applyMaterialType()
+{
+	// Waits for its shaders when they are not done yet
+	{
+		FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::ShaderCompile);
+		if (!currentMaterial()->finishInit())
+			std::cerr << "Unable to load the shaders of the material" << std::endl;
+		if (m_mixedMaterials && !material(instanceMaterialType(1))->finishInit())
+			std::cerr << "Unable to load the shaders of the mixed material" << std::endl;
+	}
+
+	m_sphereMaterial->setWireframe(m_materialType == MaterialType::Wireframe);
+	m_scene.setMaterial(m_sphereHandle, instanceMaterialType(-1));
+	for (size_t i = 0; i < m_moons.size(); ++i)
+		m_scene.setMaterial(m_moons[i].instance, instanceMaterialType(static_cast<int>(i)));
+}
+
+void MainWindow::applyMaterialSettings()
+{
+	Material* material = currentMaterial();
+	material->bind();
+	if (m_materialType == MaterialType::Lit || m_mixedMaterials)
+	{
+		m_sphereLitMaterial->setLightPosition(m_lightPosition);
+		m_sphereLitMaterial->setLightColor(m_lightColor);
+		// Waits for the variant when its shaders are not done yet
+		FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::ShaderCompile);
+		m_sphereLitMaterial->setPhong(phong);
+	}
+	updateMaterialInstances();
+}
+
+void MainWindow::updateMaterialInstances()
+{
+	MaterialTable::Parameters parameters;
+	parameters.ambiant = glm::vec4(m_ambiant, 1.0f);
+	parameters.diffuse = glm::vec4(m_diffuse, 1.0f);
+	parameters.specular = m_specular;
+	parameters.specularExponent = m_sExponent;
+
+	m_materialTable.resize(m_coloredMoons ? m_moons.size() + 1 : 1);
+	m_materialTable.set(SphereMaterialInstance, parameters);
+	if (!m_coloredMoons)
+		return;
+
+	for (size_t i = 0; i < m_moons.size(); ++i)
+	{
+		// Hues spread by the golden ratio, neighbours never look alike
+		const float hue = std::fmod(0.618034f * static_cast<float>(i + 1), 1.0f);
+		parameters.diffuse = glm::vec4(glm::clamp(glm::abs(glm::fract(hue + glm::vec3(1.0f, 2.0f / 3.0f, 1.0f / 3.0f)) * 6.0f - 3.0f) - 1.0f, 0.0f, 1.0f), 1.0f);
+		m_materialTable.set(m_scene.materialInstance(m_moons[i].instance), parameters);
+	}
+}
+
+void MainWindow::applyOptions(const Options& options)
+{
+	switch (options.material)
+	{
+	case Options::Material::Lit:
+		m_materialType = MaterialType::Lit;
+		break;
+	case Options::Material::Unlit:
+		m_materialType = MaterialType::Unlit;
+		break;
+	case Options::Material::Wireframe:
+		m_materialType = MaterialType::Wireframe;
+		break;
+	}
+	phong = options.phong;
+	camEnable = options.camera;
+	m_mixedMaterials = options.mixedMaterials;
+	m_coloredMoons = options.coloredMoons;
+	m_sortDraws = options.sortDraws;
+
+	m_radius = options.radius;
+	m_longitude = options.longitude;
+	m_latitude = options.latitude;
+	m_moonCount = options.moons;
+	m_frameTimings.setBudget(options.frameBudget);
+	GpuResourceRegistry::instance().setBudget(static_cast<size_t>(static_cast<double>(options.gpuBudget) * 1024.0 * 1024.0));
+	ProgramCache::instance().setDirectory(options.shaderCache);
+}
+
+void MainWindow::initializeScene()
+{
+	m_sphereHandle = m_scene.create(glm::vec3(0.0f), m_radius, instanceMaterialType(-1), SphereMaterialInstance);
+	m_sphereNode = m_transforms.create();
+	rebuildMoons();
+}
+
 void MainWindow::renderImgui()
 {
+	PROFILE_ZONE("MainWindow::renderImgui");
+	ALLOCATION_TAG("MainWindow::renderImgui");
 	// Start the Dear ImGui frame
 	ImGui_ImplOpenGL3_NewFrame();
-	ImGui_ImplGlfw_NewFrame();
+	if (m_window) {
+		ImGui_ImplGlfw_NewFrame();
+	}
+	else {
+		ImGuiIO& io = ImGui::GetIO();
+		io.DisplaySize = ImVec2(static_cast<float>(m_framebufferWidth), static_cast<float>(m_framebufferHeight));
+		io.DeltaTime = m_deltaTime;
+	}
 	ImGui::NewFrame();
 
 	//imgui
@@ -131,26 +276,11 @@ void MainWindow::renderImgui()
 
 		// Material
 		const char* materialNames[] = { "Lit", "Unlit", "Wireframe" };
-		static int materialIndex = 0;
+		int materialIndex = static_cast<int>(m_materialType);
 		if (ImGui::Combo("Shading", &materialIndex, materialNames, IM_ARRAYSIZE(materialNames))) 
 		{
-			switch (materialIndex)
-			{
-			case 0:
-				m_materialType = MaterialType::Lit;
-				m_sphere->setMaterial(m_sphereLitMaterial);
-				break;
-			case 1:
-				m_materialType = MaterialType::Unlit;
-				m_sphere->setMaterial(m_sphereMaterial);
-				m_sphereMaterial->setWireframe(false);
-				break;
-			default:
-				m_materialType = MaterialType::Wireframe;
-				m_sphere->setMaterial(m_sphereMaterial);
-				m_sphereMaterial->setWireframe(true);
-				break;
-			}
+			m_materialType = static_cast<MaterialType>(materialIndex);
+			applyMaterialType();
 		}
 		
 		// Color
@@ -162,17 +292,13 @@ void MainWindow::renderImgui()
 			ImGui::ColorEdit3("Diffuse", &m_diffuse[0]);
 			ImGui::ColorEdit3("Specular", &m_specular[0]);
 			ImGui::InputFloat("Specular exponent", &m_sExponent, 1.0f);
-
-			m_sphereLitMaterial->setAmbiantColor(m_ambiant);
-			m_sphereLitMaterial->setDiffuseColor(m_diffuse);
-			m_sphereLitMaterial->setSpecularColor(m_specular);
-			m_sphereLitMaterial->setSpecularExponent(m_sExponent);
 		}
 		else
 		{
 			ImGui::ColorEdit3("Base color", &m_diffuse[0]);
-			m_sphereMaterial->setColor(m_diffuse);
 		}
+		// Only the changed instances are uploaded
+		updateMaterialInstances();
 
 		// Light
 		ImGui::Separator();
@@ -182,7 +308,7 @@ void MainWindow::renderImgui()
 		ImGui::InputFloat("Z", &m_lightPosition[2], 0.05f);
 		ImGui::ColorEdit4("Color", &m_lightColor[0]);
 
-		if (m_materialType == MaterialType::Lit)
+		if (m_materialType == MaterialType::Lit || m_mixedMaterials)
 		{
 			m_sphereLitMaterial->setLightPosition(m_lightPosition);
 			m_sphereLitMaterial->setLightColor(m_lightColor);
@@ -197,42 +323,546 @@ void MainWindow::renderImgui()
 		changed |= ImGui::InputInt("Longitude", &m_longitude);
 		changed |= ImGui::InputInt("Latitude", &m_latitude);
 		if (changed) {
+			FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::Geometry);
 			m_sphere->setRadius(m_radius);
+			m_scene.setRadius(m_sphereHandle, m_sphere->radius());
 			m_sphere->setLongitude(m_longitude);
 			m_sphere->setLatitude(m_latitude);
+			// Moon radii depend on the sphere one
+			m_transforms.markDirty(m_sphereNode);
+			m_bvhMoved = true;
+		}
+
+		if (ImGui::InputInt("Moons", &m_moonCount)) {
+			m_moonCount = glm::clamp(m_moonCount, 0, 64);
+			rebuildMoons();
+		}
+		ImGui::InputFloat("Orbit speed", &m_orbitSpeed, 0.1f);
+		if (ImGui::Checkbox("Mixed materials", &m_mixedMaterials)) {
+			applyMaterialType();
+			applyMaterialSettings();
+		}
+		ImGui::Checkbox("Sort draws", &m_sortDraws);
+		if (ImGui::Checkbox("Colored moons", &m_coloredMoons))
+			rebuildMoons();
+
+		if (m_picked != SceneHandle() && m_scene.isValid(m_picked))
+			ImGui::Text("Picked sphere: #%u", m_picked.slot);
+		else
+			ImGui::Text("Picked sphere: none (left click)");
+
+		// Capture
+		ImGui::Separator();
+		ImGui::Text("Capture: ");
+		ImGui::Checkbox("Record frames", &m_recording);
+		const char* captureFormats[] = { "PNG", "TGA" };
+		ImGui::Combo("Format", &m_captureFormat, captureFormats, IM_ARRAYSIZE(captureFormats));
+		if (m_capture)
+			ImGui::Text("%zu frames captured, %zu written", m_capture->capturedCount(), m_capture->writtenCount());
+
+		// Timings
+		ImGui::Separator();
+		ImGui::Text("Timings (ms, last %d frames): ", GpuProfiler::WindowSize);
+		ImGui::Text("%-10s %6s %6s %6s %6s", "", "min", "avg", "p99", "cpu");
+		for (int i = 0; i < GpuProfiler::PassCount; ++i)
+		{
+			const GpuProfiler::Pass pass = static_cast<GpuProfiler::Pass>(i);
+			const GpuProfiler::Statistics& gpu = m_gpuProfiler.gpuStatistics(pass);
+			const GpuProfiler::Statistics& cpu = m_gpuProfiler.cpuStatistics(pass);
+			ImGui::Text("%-10s %6.3f %6.3f %6.3f %6.3f", GpuProfiler::passName(pass), gpu.min, gpu.average, gpu.p99, cpu.average);
 		}
 
         ImGui::Separator();
         ImGui::Text("Extra features");
         ImGui::Text("Lighting model");
-        static int selection = 0;
+        int selection = phong ? 0 : 1;
         ImGui::RadioButton("Phong", &selection, 0);
         ImGui::SameLine();
         ImGui::RadioButton("Blinn-Phong", &selection, 1);
         phong = selection == 0;
-        currentMaterial()->setPhong(phong);
+        {
+            // Waits for the variant when its shaders are not done yet
+            FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::ShaderCompile);
+            currentMaterial()->setPhong(phong);
+            if (m_mixedMaterials)
+                m_sphereLitMaterial->setPhong(phong);
+        }
 
         ImGui::Text("Use camera?");
-        static int camSelection = 1;
+        int camSelection = camEnable ? 0 : 1;
         ImGui::RadioButton("Yes", &camSelection, 0);
         ImGui::SameLine();
         ImGui::RadioButton("No", &camSelection, 1);
         camEnable = camSelection == 0;
 
+		// Frame times over the whole run
+		const FrameHistogram& frames = m_frameTimings.histogram();
+		ImGui::Text("Frames (ms): p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f",
+			frames.percentile(0.5), frames.percentile(0.9), frames.percentile(0.99), frames.percentile(0.999), frames.max());
+		ImGui::Text("%llu frames over %.1f ms", static_cast<unsigned long long>(m_frameTimings.stutterTotal()), m_frameTimings.budget());
+		if (m_frameTimings.stutterCount() > 0)
+		{
+			const FrameTimings::Stutter& stutter = m_frameTimings.stutter(0);
+			const FrameTimings::Subsystem longest = stutter.longest();
+			ImGui::Text("Last: frame %llu, %.2f ms, %s %.2f ms", static_cast<unsigned long long>(stutter.frame), stutter.milliseconds,
+				FrameTimings::subsystemName(longest), stutter.sections[static_cast<int>(longest)]);
+		}
+
+		// GPU memory (see GpuResourceRegistry)
+		const GpuResourceRegistry& resources = GpuResourceRegistry::instance();
+		ImGui::Text("GPU memory: %.2f MiB (peak %.2f MiB) in %zu objects", resources.total().bytes / 1048576.0,
+			resources.total().peakBytes / 1048576.0, resources.total().count);
+		if (resources.budget() > 0)
+			ImGui::Text("Budget: %.2f MiB", resources.budget() / 1048576.0);
+		for (const auto& category : resources.categories())
+			ImGui::Text("  %-20s %4zu  %.2f MiB", category.first.c_str(), category.second.count, category.second.bytes / 1048576.0);
+
+		ImGui::Checkbox("Render statistics", &m_showRenderStats);
+
+		ImGui::End();
+	}
+
+	// Overlay in the top right corner, counters of the last frame
+	if (m_showRenderStats)
+	{
+		const ImGuiViewport* viewport = ImGui::GetMainViewport();
+		ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 10.0f, viewport->WorkPos.y + 10.0f), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+		ImGui::SetNextWindowBgAlpha(0.35f);
+		const ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings
+			| ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoMove;
+		if (ImGui::Begin("Render statistics", &m_showRenderStats, flags))
+		{
+			const RenderStats& stats = RenderStats::last();
+			ImGui::Text("Draw calls      %llu", static_cast<unsigned long long>(stats.drawCalls));
+			ImGui::Text("Triangles       %llu", static_cast<unsigned long long>(stats.triangles));
+			ImGui::Text("Vertices        %llu", static_cast<unsigned long long>(stats.vertices));
+			ImGui::Text("Program binds   %llu", static_cast<unsigned long long>(stats.programBinds));
+			ImGui::Text("VAO binds       %llu", static_cast<unsigned long long>(stats.vaoBinds));
+			ImGui::Text("Uniform uploads %llu", static_cast<unsigned long long>(stats.uniformUploads));
+			ImGui::Text("Uniform skips   %llu", static_cast<unsigned long long>(stats.uniformSkips));
+			ImGui::Text("Buffer bytes    %llu", static_cast<unsigned long long>(stats.bufferBytes));
+			ImGui::Text("State changes   %llu", static_cast<unsigned long long>(stats.stateChanges));
+			ImGui::Text("Filtered states %llu", static_cast<unsigned long long>(stats.redundantStates));
+			if (Allocations::enabled())
+				ImGui::Text("Allocations     %llu", static_cast<unsigned long long>(Allocations::lastFrame().allocations));
+		}
 		ImGui::End();
 	}
 
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	// The backend changes the state behind the cache (and restores most of it)
+	GLState::invalidate();
 }
 
 void MainWindow::renderScene()
 {
+	PROFILE_ZONE("MainWindow::renderScene");
+	ALLOCATION_TAG("MainWindow::renderScene");
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	m_sphere->render();
+	m_scene.cull(viewProjection());
+	m_scene.updateLods(glm::vec3(m_viewPosition.x, m_viewPosition.y, -m_viewPosition.z));
+	const std::vector<uint32_t>& drawList = m_scene.buildDrawList();
+
+	// Drawn front to back within a material, the depth test rejects more
+	const glm::mat4 viewProj = viewProjection();
+	m_renderQueue.clear();
+	for (uint32_t index : drawList)
+	{
+		const uint32_t materialType = m_scene.denseMaterial(index);
+		Material* material = this->material(materialType);
+		const glm::vec4 clip = viewProj * glm::vec4(m_scene.densePosition(index), 1.0f);
+		const float depth = clip.w > 0.0f ? 0.5f * clip.z / clip.w + 0.5f : 0.0f;
+
+		const uint64_t key = RenderQueue::makeKey(RenderQueue::OpaqueLayer, material->programId(), materialType, m_sphere->vertexArrayId(), depth);
+		m_renderQueue.push(key, { material, m_sphere.get(), instanceModel(index), m_scene.denseMaterialInstance(index) });
+	}
+
+	if (m_sortDraws)
+		m_renderQueue.sort(&ThreadPool::global());
+	if (m_materialTable.update())
+		m_renderQueue.submit(m_instanceBuffer);
+}
+
+int MainWindow::renderHeadless(const std::string& outputPath, int width, int height, int frameCount, float frameTime)
+{
+	if (width <= 0 || height <= 0) {
+		std::cerr << "Invalid rendering size " << width << "x" << height << std::endl;
+		return 1;
+	}
+
+	HeadlessContext context;
+	if (!context.create(GLMajorVersion, GLMinorVersion)) {
+		return 1;
+	}
+	std::cout << "Headless context (" << context.api() << "): " << glGetString(GL_RENDERER) << std::endl;
+
+	int init_value = initializeGL();
+	if (init_value != 0) {
+		return init_value;
+	}
+
+	Framebuffer framebuffer;
+	if (!framebuffer.create(width, height)) {
+		releaseGL();
+		return 4;
+	}
+	framebuffer.bind();
+	m_framebufferWidth = width;
+	m_framebufferHeight = height;
+
+	applyMaterialSettings();
+
+	FrameCapture capture;
+	const auto start = std::chrono::steady_clock::now();
+	auto frameStart = start;
+	for (int frame = 0; frame < frameCount; ++frame)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		m_frameTimings.nextFrame(std::chrono::duration<double, std::milli>(now - frameStart).count());
+		frameStart = now;
+
+		{
+			FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::Update);
+			updateCamera();
+			updateTransforms(static_cast<float>(frame) * frameTime);
+		}
+		{
+			FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::Scene);
+			m_gpuProfiler.begin(GpuProfiler::Pass::Scene);
+			renderScene();
+			m_gpuProfiler.end(GpuProfiler::Pass::Scene);
+		}
+		m_gpuProfiler.update();
+		RenderStats::endFrame();
+		FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::Capture);
+
+		// Numbered files when saving an animation: image_0000.png, ...
+		std::string path = outputPath;
+		if (frameCount > 1) {
+			char suffix[16];
+			std::snprintf(suffix, sizeof(suffix), "_%04d", frame);
+			const size_t extension = path.find_last_of('.');
+			path.insert(extension == std::string::npos ? path.size() : extension, suffix);
+		}
+
+		capture.capture(path, width, height);
+		capture.update();
+	}
+	const double renderSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	m_frameTimings.nextFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+	capture.finish();
+	const double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << frameCount << " frames rendered in " << renderSeconds << " s (" << frameCount / renderSeconds << " fps), "
+		<< capture.writtenCount() << " written after " << totalSeconds << " s" << std::endl;
+
+	glFinish();
+	m_gpuProfiler.update();
+	const GpuProfiler::Statistics& gpu = m_gpuProfiler.gpuStatistics(GpuProfiler::Pass::Scene);
+	std::cout << "Scene GPU time: " << gpu.min << " ms min, " << gpu.average << " ms average, " << gpu.p99 << " ms p99 over "
+		<< gpu.count << " frames" << std::endl;
+	m_gpuProfiler.destroy();
+
+	const RenderStats& stats = RenderStats::last();
+	std::cout << "Last frame: " << stats.drawCalls << " draw calls, " << stats.triangles << " triangles, "
+		<< stats.programBinds << " program binds, " << stats.vaoBinds << " VAO binds, " << stats.uniformUploads << " uniform uploads, " << stats.uniformSkips << " skipped, "
+		<< stats.bufferBytes << " buffer bytes, " << stats.stateChanges << " state changes, " << stats.redundantStates << " filtered" << std::endl;
+	const ProgramCache& programCache = ProgramCache::instance();
+	if (!programCache.directory().empty())
+		std::cout << "Shader programs: " << programCache.hits() << " loaded from the cache, " << programCache.misses() << " compiled" << std::endl;
+	printFrameTimings();
+	GpuResourceRegistry::instance().report(std::cout);
+
+	Framebuffer::bindDefault();
+	releaseGL();
+	return capture.failedCount() == 0 ? 0 : 5;
+}
+
+int MainWindow::runBenchmark(const std::string& outputPath, int width, int height, int frameCount, int warmupFrames)
+{
+	using Clock = std::chrono::steady_clock;
+	const int Subdivisions[] = { 8, 16, 32, 64, 128, 256, 512 };
+	const int Rebuilds = 5;
+
+	HeadlessContext context;
+	if (!context.create(GLMajorVersion, GLMinorVersion)) {
+		return 1;
+	}
+
+	int init_value = initializeGL();
+	if (init_value != 0) {
+		return init_value;
+	}
+
+	Framebuffer framebuffer;
+	if (!framebuffer.create(width, height)) {
+		releaseGL();
+		return 4;
+	}
+	framebuffer.bind();
+	m_framebufferWidth = width;
+	m_framebufferHeight = height;
+
+	const std::string renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	std::cout << "Benchmark on " << renderer << " (" << context.api() << "), " << width << "x" << height << std::endl;
+
+	BenchmarkReport report;
+	report.setEnvironment(renderer, width, height, frameCount, warmupFrames);
+	GpuTimer gpuTimer;
+	// The timer drops its first query (see GpuTimer::readOldest), spend it
+	// on an unmeasured frame so that every configuration gets one result per frame
+	double milliseconds = 0.0;
+	gpuTimer.begin();
+	renderScene();
+	gpuTimer.end();
+	gpuTimer.poll(milliseconds, true);
+
+	std::vector<double> generation, upload, cpuFrame, gpuFrame;
+	for (int subdivisions : Subdivisions)
+	{
+		// Rebuild the buffers a few times, waiting for the driver to be done with them
+		generation.clear();
+		upload.clear();
+		for (int i = 0; i < Rebuilds; ++i)
+		{
+			glFinish();
+			const auto start = Clock::now();
+			m_sphere->setSubdivisions(subdivisions, subdivisions);
+			glFinish();
+			const double total = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			generation.push_back(m_sphere->lastBuildTimings().generation);
+			upload.push_back(total - m_sphere->lastBuildTimings().generation);
+		}
+		m_longitude = m_latitude = subdivisions;
+
+		const MaterialType Materials[] = { MaterialType::Lit, MaterialType::Unlit, MaterialType::Wireframe };
+		const char* MaterialNames[] = { "lit", "unlit", "wireframe" };
+		for (int m = 0; m < 3; ++m)
+		{
+			m_materialType = Materials[m];
+			applyMaterialType();
+
+			// The lighting model only matters for the lit material
+			const int lightingCount = m_materialType == MaterialType::Lit ? 2 : 1;
+			for (int l = 0; l < lightingCount; ++l)
+			{
+				phong = l == 0;
+				applyMaterialSettings();
+
+				cpuFrame.clear();
+				gpuFrame.clear();
+				int gpuResults = 0;
+				for (int frame = 0; frame < warmupFrames + frameCount; ++frame)
+				{
+					const auto start = Clock::now();
+					updateCamera();
+					updateTransforms(static_cast<float>(frame) / 60.0f);
+					gpuTimer.begin();
+					renderScene();
+					gpuTimer.end();
+					if (frame >= warmupFrames)
+						cpuFrame.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+					// Results come back in frame order
+					while (gpuTimer.poll(milliseconds))
+						if (gpuResults++ >= warmupFrames)
+							gpuFrame.push_back(milliseconds);
+				}
+				while (gpuTimer.poll(milliseconds, true))
+					if (gpuResults++ >= warmupFrames)
+						gpuFrame.push_back(milliseconds);
+
+				BenchmarkReport::Configuration configuration;
+				configuration.longitude = subdivisions;
+				configuration.latitude = subdivisions;
+				configuration.triangles = m_sphere->triangleCount();
+				configuration.material = MaterialNames[m];
+				configuration.lighting = m_materialType == MaterialType::Lit ? (phong ? "phong" : "blinn") : "none";
+				report.add(configuration, generation, upload, cpuFrame, gpuFrame);
+
+				std::cout << subdivisions << "x" << subdivisions << " " << configuration.material << " " << configuration.lighting
+					<< ": cpu p50 " << BenchmarkReport::summarize(cpuFrame).p50
+					<< " ms, gpu p50 " << BenchmarkReport::summarize(gpuFrame).p50 << " ms" << std::endl;
+			}
+		}
+	}
+
+	gpuTimer.destroy();
+	Framebuffer::bindDefault();
+	releaseGL();
+	return report.write(outputPath) ? 0 : 5;
+}
+
+int MainWindow::checkAllocations(int width, int height, int frameCount, int warmupFrames)
+{
+	if (!Allocations::enabled()) {
+		std::cerr << "Allocations are not counted in this build, configure with ENABLE_ALLOCATION_TRACKING" << std::endl;
+		return 1;
+	}
+
+	// A hidden window when possible, for the input and interface backends
+	// of renderLoop. With EGL, ImGui only has its OpenGL backend.
+	HeadlessContext context;
+	if (!context.create(GLMajorVersion, GLMinorVersion, true)) {
+		return 1;
+	}
+	m_window = context.window();
+	if (m_window)
+		glfwSetWindowSize(m_window, width, height);
+	std::cout << "Headless context (" << context.api() << "): " << glGetString(GL_RENDERER) << std::endl;
+	initializeImgui();
+
+	int init_value = initializeGL();
+	if (init_value != 0) {
+		releaseImgui();
+		m_window = nullptr;
+		return init_value;
+	}
+
+	Framebuffer framebuffer;
+	if (!framebuffer.create(width, height)) {
+		releaseGL();
+		releaseImgui();
+		m_window = nullptr;
+		return 4;
+	}
+	framebuffer.bind();
+	m_framebufferWidth = width;
+	m_framebufferHeight = height;
+	applyMaterialSettings();
+
+	// The frames of renderLoop, at a fixed frame rate
+	Allocations::Counts tagsBefore[Allocations::MaxTags];
+	int allocatingFrames = 0;
+	uint64_t worstFrame = 0;
+	m_deltaTime = 1.0f / 60.0f;
+	Allocations::endFrame();
+	for (int frame = 0; frame < warmupFrames + frameCount; ++frame)
+	{
+		if (frame == warmupFrames) {
+			for (int i = 0; i < Allocations::MaxTags; ++i)
+				tagsBefore[i] = i < Allocations::tagCount() ? Allocations::tagCounts(i) : Allocations::Counts();
+		}
+
+		renderFrame(static_cast<float>(frame) * m_deltaTime);
+
+		const Allocations::Counts counts = Allocations::lastFrame();
+		if (frame >= warmupFrames && counts.allocations > 0) {
+			++allocatingFrames;
+			worstFrame = std::max(worstFrame, counts.allocations);
+		}
+	}
+	glFinish();
+
+	std::cout << allocatingFrames << " of " << frameCount << " frames allocated after " << warmupFrames << " warmup frames";
+	if (allocatingFrames > 0)
+		std::cout << ", up to " << worstFrame << " allocations in a frame";
+	std::cout << std::endl;
+	for (int i = 0; i < Allocations::tagCount(); ++i)
+	{
+		const Allocations::Counts counts = Allocations::tagCounts(i);
+		const uint64_t allocations = counts.allocations - tagsBefore[i].allocations;
+		if (allocations > 0)
+			std::cout << "  " << Allocations::tagName(i) << ": " << allocations << " allocations, " << counts.bytes - tagsBefore[i].bytes << " bytes" << std::endl;
+	}
+
+	Framebuffer::bindDefault();
+	releaseGL();
+	releaseImgui();
+	m_window = nullptr;
+	return allocatingFrames == 0 ? 0 : 6;
+}
+
+int MainWindow::renderSoftware(const std::string& outputPath, int width, int height)
+{
+	if (!initializeOffline(width, height))
+		return 1;
+
+	SphereMesh mesh;
+	SphereGeometry(m_radius, m_longitude, m_latitude).generate(mesh);
+
+	SoftwareRenderer renderer(width, height);
+	renderer.setParameters(shadingParameters());
+	renderer.setCamera(m_projection, m_view, m_viewPosition);
+
+	m_scene.cull(viewProjection());
+	renderer.clear();
+	for (uint32_t index = 0; index < m_scene.size(); ++index)
+	{
+		if (m_scene.denseFlags(index) & Scene::Visible)
+			renderer.draw(mesh, instanceModel(index));
+	}
+	renderer.finish();
+
+	if (!writeImage(outputPath, width, height, renderer.pixels())) {
+		std::cerr << "Failed to write " << outputPath << std::endl;
+		return 2;
+	}
+	return 0;
+}
+
+int MainWindow::renderRayTraced(const std::string& outputPath, int width, int height, int samples)
+{
+	if (!initializeOffline(width, height))
+		return 1;
+
+	RayTracer rayTracer(width, height);
+	rayTracer.setParameters(shadingParameters());
+	rayTracer.setCamera(m_projection, m_view, m_viewPosition);
+	rayTracer.setScene(m_scene);
+
+	const RayTracer::Statistics statistics = rayTracer.render(std::max(1, samples));
+	std::cout << statistics.passes << " samples per pixel in " << statistics.seconds << " s: "
+		<< statistics.raysPerSecond / 1e6 << " Mrays/s, "
+		<< statistics.imagesPerSecondPerCore << " images/s per core (" << statistics.cores << " cores)" << std::endl;
+
+	if (!writeImage(outputPath, width, height, rayTracer.resolve())) {
+		std::cerr << "Failed to write " << outputPath << std::endl;
+		return 2;
+	}
+	return 0;
+}
+
+bool MainWindow::initializeOffline(int width, int height)
+{
+	if (width <= 0 || height <= 0) {
+		std::cerr << "Invalid rendering size " << width << "x" << height << std::endl;
+		return false;
+	}
+
+	initializeScene();
+	updateMatrices(static_cast<float>(width) / static_cast<float>(height));
+	updateTransforms(0.0f);
+	return true;
 }
 
+ShadingParameters MainWindow::shadingParameters() const
+{
+	ShadingParameters parameters;
+	switch (m_materialType)
+	{
+	case MaterialType::Lit:
+		parameters.shading = ShadingModel::Lit;
+		break;
+	case MaterialType::Unlit:
+		parameters.shading = ShadingModel::Unlit;
+		break;
+	case MaterialType::Wireframe:
+		parameters.shading = ShadingModel::Wireframe;
+		break;
+	}
+	parameters.color = m_diffuse;
+	parameters.ambiant = m_ambiant;
+	parameters.diffuse = m_diffuse;
+	parameters.specular = m_specular;
+	parameters.specularExponent = m_sExponent;
+	parameters.lightPosition = m_lightPosition;
+	parameters.lightColor = m_lightColor;
+	parameters.phong = phong;
+	return parameters;
+}
 
 int MainWindow::renderLoop()
 {
@@ -242,37 +872,140 @@ int MainWindow::renderLoop()
         auto currentFrame = static_cast<float>(glfwGetTime());
         m_deltaTime = currentFrame - m_lastFrame;
         m_lastFrame = currentFrame;
+		renderFrame(currentFrame);
+	}
+	printFrameTimings();
+
+	// Cleanup
+	releaseGL();
+	releaseImgui();
+
+	GpuResourceRegistry::instance().contextDestroyed();
+	glfwDestroyWindow(m_window);
+	glfwTerminate();
+
+	return 0;
+}
 
+void MainWindow::renderFrame(float time)
+{
+	PROFILE_ZONE("Frame");
+	m_frameTimings.nextFrame(m_deltaTime * 1000.0);
+
+	if (m_window) {
+		FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::Input);
 		processInput();
-        updateCamera();
+	}
+	{
+		FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::ShaderCompile);
+		finishMaterials();
+	}
+	{
+		FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::Update);
+		updateCamera();
+		updateTransforms(time);
+	}
 
+	{
+		FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::Scene);
+		m_gpuProfiler.begin(GpuProfiler::Pass::Scene);
 		renderScene();
+		m_gpuProfiler.end(GpuProfiler::Pass::Scene);
+	}
+	{
+		FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::Capture);
+		captureFrame();
+	}
+	{
+		FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::Interface);
+		m_gpuProfiler.begin(GpuProfiler::Pass::Interface);
 		renderImgui();
+		m_gpuProfiler.end(GpuProfiler::Pass::Interface);
+	}
 
-		// Show rendering and get events
+	// Show rendering and get events
+	if (m_window) {
+		PROFILE_ZONE("glfwSwapBuffers");
+		FrameTimings::Section section(m_frameTimings, FrameTimings::Subsystem::Present);
 		glfwSwapBuffers(m_window);
 		glfwPollEvents();
 	}
+	m_gpuProfiler.update();
+	RenderStats::endFrame();
+	Allocations::endFrame();
+}
 
-	// Cleanup
-	ImGui_ImplOpenGL3_Shutdown();
-	ImGui_ImplGlfw_Shutdown();
-	ImGui::DestroyContext();
+void MainWindow::captureFrame()
+{
+	ALLOCATION_TAG("MainWindow::captureFrame");
+	if (m_recording)
+	{
+		// Encoder threads are only started for the first capture
+		if (!m_capture)
+			m_capture = std::make_unique<FrameCapture>();
 
-	glfwDestroyWindow(m_window);
-	glfwTerminate();
+		char path[32];
+		std::snprintf(path, sizeof(path), "capture_%05d.%s", m_captureIndex++, m_captureFormat == 0 ? "png" : "tga");
 
-	return 0;
+		int width, height;
+		glfwGetFramebufferSize(m_window, &width, &height);
+		m_capture->capture(path, width, height);
+	}
+
+	if (m_capture)
+		m_capture->update();
+}
+
+void MainWindow::finishMaterials()
+{
+	Material* materials[] = { m_sphereMaterial.get(), m_sphereLitMaterial.get() };
+	for (Material* material : materials)
+		material->finishCompiledVariants();
+}
+
+void MainWindow::releaseGL()
+{
+	if (m_capture)
+		m_capture->finish();
+	m_gpuProfiler.destroy();
+	m_frameUniforms.destroy();
+	m_materialTable.destroy();
+	m_instanceBuffer.destroy();
+	m_sphere.reset();
+	m_sphereMaterial.reset();
+	m_sphereLitMaterial.reset();
+}
+
+void MainWindow::printFrameTimings() const
+{
+	const FrameHistogram& frames = m_frameTimings.histogram();
+	std::cout << "Frame times over " << frames.count() << " frames: p50 " << frames.percentile(0.5) << " ms, p90 " << frames.percentile(0.9)
+		<< " ms, p99 " << frames.percentile(0.99) << " ms, p99.9 " << frames.percentile(0.999) << " ms, max " << frames.max() << " ms" << std::endl;
+
+	std::cout << m_frameTimings.stutterTotal() << " frames over the " << m_frameTimings.budget() << " ms budget";
+	if (m_frameTimings.stutterCount() > 0) {
+		const FrameTimings::Stutter& stutter = m_frameTimings.stutter(0);
+		const FrameTimings::Subsystem longest = stutter.longest();
+		std::cout << ", latest is frame " << stutter.frame << " (" << stutter.milliseconds << " ms, "
+			<< FrameTimings::subsystemName(longest) << " " << stutter.sections[static_cast<int>(longest)] << " ms)";
+	}
+	std::cout << std::endl;
 }
 
 void MainWindow::framebufferSizeCallback(int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that width and
 	// height will be significantly larger than specified on retina displays.
-	glViewport(0, 0, width, height);
+	GLState::viewport(0, 0, width, height);
+	if (width > 0 && height > 0) {
+		m_framebufferWidth = width;
+		m_framebufferHeight = height;
+	}
 }
 
 void MainWindow::processInput() {
+	PROFILE_ZONE("MainWindow::processInput");
+	ALLOCATION_TAG("MainWindow::processInput");
     // Check inputs: Does ESC was pressed?
     if (glfwGetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(m_window, true);
@@ -285,29 +1018,152 @@ void MainWindow::processInput() {
     else {
         glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
+
+    // Pick on the left button press, unless the click is for the interface
+    const bool leftDown = glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    if (leftDown && !mouseLeftDown && !ImGui::GetIO().WantCaptureMouse) {
+        pickAtCursor();
+    }
+    mouseLeftDown = leftDown;
 }
 
 void MainWindow::updateCamera() {
-	Material* material = currentMaterial();
+	PROFILE_ZONE("MainWindow::updateCamera");
+	ALLOCATION_TAG("MainWindow::updateCamera");
+    updateMatrices((float) m_framebufferWidth / (float) m_framebufferHeight);
+    m_frameUniforms.update(m_projection, m_view, m_viewPosition);
+}
+
+void MainWindow::updateMatrices(float aspectRatio) {
     if (camEnable)
     {
-        material->setProjection(
-                glm::perspective(glm::radians(cam.Zoom), (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f));
-        material->setView(cam.GetViewMatrix());
-        material->setViewPost(cam.GetPosition());
+        m_projection = glm::perspective(glm::radians(cam.Zoom), aspectRatio, 0.1f, 100.0f);
+        m_view = cam.GetViewMatrix();
+        m_viewPosition = cam.GetPosition();
     }
     else
     {
-        material->setProjection(glm::mat4(1.0f));
-        material->setView(glm::mat4(1.0f));
-        material->setViewPost(glm::vec3{0,0,-1});
+        m_projection = glm::mat4(1.0f);
+        m_view = glm::mat4(1.0f);
+        m_viewPosition = glm::vec3{0,0,-1};
     }
 }
 
+void MainWindow::updateTransforms(float time)
+{
+	PROFILE_ZONE("MainWindow::updateTransforms");
+	ALLOCATION_TAG("MainWindow::updateTransforms");
+	for (const Moon& moon : m_moons)
+		m_transforms.setLocalRotation(moon.orbit, glm::angleAxis(time * moon.speed * m_orbitSpeed, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	m_transforms.update();
+
+	// Only the moved nodes are copied back into the scene
+	for (const TransformHandle& node : m_transforms.changedNodes())
+	{
+		const uint32_t moonIndex = m_transforms.userData(node);
+		if (moonIndex == TransformHierarchy::NoUserData)
+			continue;
+
+		const glm::mat4& world = m_transforms.worldMatrix(node);
+		const float scale = glm::length(glm::vec3(world[0]));
+		m_scene.setPosition(m_moons[moonIndex].instance, glm::vec3(world[3]));
+		m_scene.setRadius(m_moons[moonIndex].instance, sphereRadius() * scale);
+		m_bvhMoved = true;
+	}
+}
+
+void MainWindow::rebuildMoons()
+{
+	for (const Moon& moon : m_moons)
+	{
+		m_transforms.destroy(moon.orbit);
+		m_scene.destroy(moon.instance);
+	}
+	m_moons.clear();
+
+	for (int i = 0; i < m_moonCount; ++i)
+	{
+		// Every other moon has a smaller moon of its own
+		const bool moonlet = i % 2 == 1;
+		const TransformHandle parent = moonlet ? m_moons.back().body : m_sphereNode;
+
+		Moon moon;
+		moon.orbit = m_transforms.create(parent);
+		moon.body = m_transforms.create(moon.orbit);
+		// Colored moons have an instance of their own after the one of the sphere
+		const uint32_t materialInstance = m_coloredMoons ? static_cast<uint32_t>(i + 1) : SphereMaterialInstance;
+		moon.instance = m_scene.create(glm::vec3(0.0f), m_radius, instanceMaterialType(i), materialInstance);
+		moon.speed = moonlet ? 2.0f : 1.0f / static_cast<float>(i / 2 + 1);
+
+		const float distance = moonlet ? 2.0f : 1.5f + 0.75f * static_cast<float>(i / 2);
+		m_transforms.setLocalPosition(moon.body, glm::vec3(distance, 0.0f, 0.0f));
+		m_transforms.setLocalScale(moon.body, glm::vec3(moonlet ? 0.4f : 0.2f));
+		m_transforms.setUserData(moon.body, static_cast<uint32_t>(m_moons.size()));
+
+		m_moons.push_back(moon);
+	}
+
+	// Room for every instance, renderScene() must not allocate when more become visible
+	m_renderQueue.reserve(m_scene.size());
+	updateMaterialInstances();
+	m_bvhDirty = true;
+}
+
+void MainWindow::pickAtCursor()
+{
+	if (m_bvhDirty) {
+		m_bvh.build(m_scene);
+		m_bvhDirty = false;
+		m_bvhMoved = false;
+	}
+	else if (m_bvhMoved) {
+		m_bvh.refit(m_scene);
+		m_bvhMoved = false;
+	}
+
+	double x, y;
+	int width, height;
+	glfwGetCursorPos(m_window, &x, &y);
+	glfwGetWindowSize(m_window, &width, &height);
+	if (width <= 0 || height <= 0)
+		return;
+
+	const glm::vec2 ndc(2.0f * static_cast<float>(x) / width - 1.0f, 1.0f - 2.0f * static_cast<float>(y) / height);
+	RayHit hit;
+	m_bvh.pick(viewProjection(), &ndc, &hit, 1);
+	m_picked = hit.instance;
+}
+
+glm::mat4 MainWindow::viewProjection() const
+{
+	// The vertex shaders mirror the z axis before applying the view
+	const glm::mat4 mirrorZ = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 1.0f, -1.0f));
+	return m_projection * m_view * mirrorZ;
+}
+
+float MainWindow::sphereRadius() const
+{
+	return m_sphere ? m_sphere->radius() : m_radius;
+}
+
+glm::mat4 MainWindow::instanceModel(uint32_t index) const
+{
+	// The mesh is generated with its own radius, scale it to the instance one
+	const float scale = m_scene.denseRadius(index) / sphereRadius();
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), m_scene.densePosition(index));
+	return glm::scale(model, glm::vec3(scale));
+}
+
 Material* MainWindow::currentMaterial()
+{
+	return material(static_cast<uint32_t>(m_materialType));
+}
+
+Material* MainWindow::material(uint32_t materialType)
 {
 	Material* material = nullptr;
-	switch(m_materialType)
+	switch(static_cast<MaterialType>(materialType))
 	{
 	case MaterialType::Lit:
 		material = m_sphereLitMaterial.get();
@@ -320,6 +1176,14 @@ Material* MainWindow::currentMaterial()
 	return material;
 }
 
+uint32_t MainWindow::instanceMaterialType(int moonIndex) const
+{
+	if (!m_mixedMaterials || moonIndex < 0 || moonIndex % 2 == 0)
+		return static_cast<uint32_t>(m_materialType);
+	const MaterialType other = m_materialType == MaterialType::Lit ? MaterialType::Unlit : MaterialType::Lit;
+	return static_cast<uint32_t>(other);
+}
+
 void MainWindow::handleScroll(double yDelta) {
     if(mouseRightDown && camEnable) {
         cam.ProcessMouseScroll(static_cast<float>(yDelta));
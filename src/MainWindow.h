@@ -16,51 +16,126 @@
 #include <glm/glm.hpp>
 
 #include <iostream>
+#include <string>
 #include <vector>
 #include <memory>
 #include <glm/gtx/euler_angles.hpp>
 
 #include "ShaderProgram.h"
 #include "Sphere.h"
+#include "Scene.h"
+#include "TransformHierarchy.h"
+#include "SphereBVH.h"
+#include "ShaderPorts.h"
 #include "BasicMaterial.h"
 #include "LitMaterial.h"
 #include "Camera.h"
+#include "Options.h"
+#include "FrameCapture.h"
+#include "GpuProfiler.h"
+#include "FrameUniforms.h"
+#include "RenderQueue.h"
+#include "MaterialTable.h"
+#include "InstanceBuffer.h"
+#include "FrameTimings.h"
 
 class MainWindow
 {
 public:
+	// Version of the contexts, the buffers use direct state access
+	static const int GLMajorVersion = 4;
+	static const int GLMinorVersion = 5;
+
 	MainWindow();
 
+	// Settings given on the command line, before initialisation
+	void applyOptions(const Options& options);
+
 	// Main functions (initialization, run)
 	int initialisation();
 	int renderLoop();
+	// Render frames with OpenGL into an offscreen framebuffer and save them, no window needed
+	int renderHeadless(const std::string& outputPath, int width, int height, int frameCount, float frameTime);
+	// Time the rendering of every subdivision, material and lighting model (see BenchmarkReport)
+	int runBenchmark(const std::string& outputPath, int width, int height, int frameCount, int warmupFrames);
+	// Render frames like renderLoop, in a hidden window when possible, fail if any frame after the warmup allocates
+	int checkAllocations(int width, int height, int frameCount, int warmupFrames);
+	// Render one frame on the CPU (see SoftwareRenderer) and save it, no window needed
+	int renderSoftware(const std::string& outputPath, int width, int height);
+	// Render one frame with the reference ray tracer (see RayTracer) and save it
+	int renderRayTraced(const std::string& outputPath, int width, int height, int samples);
 
 	// Callback to intersept GLFW calls
 	void framebufferSizeCallback(int width, int height);
 
+	// Timings of the render passes of the window, a few frames old
+	inline const GpuProfiler& gpuProfiler() const { return m_gpuProfiler; }
+
 private:
 	// Initialize GLFW callbacks
 	void initializeCallback();
+	// Dear ImGui context and its backends, on m_window
+	void initializeImgui();
+	void releaseImgui();
 	// Intiialize OpenGL objects (shaders, ...)
 	int initializeGL(); 
+	// Initialize the sphere instances and their transforms
+	void initializeScene();
+	// Use the material of m_materialType for the sphere instances
+	void applyMaterialType();
+	// Bind the current material, set its light uniforms and the material instances
+	void applyMaterialSettings();
+	// Parameters of the material instances from the color settings
+	void updateMaterialInstances();
+	// Scene and matrices for the renderers that do not open a window
+	bool initializeOffline(int width, int height);
 	
+	// One iteration of renderLoop: input, update, scene, capture, interface and
+	// present. Without m_window (see checkAllocations), no input and no present.
+	void renderFrame(float time);
 	// Rendering scene (OpenGL)
 	void renderScene();
 	// Rendering interface ImGUI
 	void renderImgui();
+	// Save the rendered scene when recording (see FrameCapture)
+	void captureFrame();
 
     void handleMouse(double xpos, double ypos);
     void handleScroll(double yDelta);
     void processInput();
     void updateCamera();
+    void updateMatrices(float aspectRatio);
+    void updateTransforms(float time);
+    void rebuildMoons();
+    void pickAtCursor();
+    // Percentiles and latest stutter of m_frameTimings on std::cout
+    void printFrameTimings() const;
+    // Finish the material variants whose shaders are compiled, without waiting for the others
+    void finishMaterials();
+    // Delete the OpenGL objects, before the context is destroyed
+    void releaseGL();
 
 private:
 	Material* currentMaterial();
+	// Material drawing the instances of this type (Unlit and Wireframe share one)
+	Material* material(uint32_t materialType);
+	// Material type of the scene instance of a moon, or of the sphere with -1
+	uint32_t instanceMaterialType(int moonIndex) const;
+	// Projection * view, including the z mirroring done by the vertex shaders
+	glm::mat4 viewProjection() const;
+	// Radius the sphere mesh is generated with
+	float sphereRadius() const;
+	// Model matrix of a dense scene instance drawn with the sphere mesh
+	glm::mat4 instanceModel(uint32_t index) const;
+	// Uniforms of the current material, for the CPU renderers
+	ShadingParameters shadingParameters() const;
 
 	// Settings
 	const unsigned int SCR_WIDTH = 900;
 	const unsigned int SCR_HEIGHT = 900;
 	GLFWwindow* m_window = nullptr;
+	int m_framebufferWidth = SCR_WIDTH;
+	int m_framebufferHeight = SCR_HEIGHT;
 
 	// Material type
 	enum class MaterialType {Lit, Unlit, Wireframe};
@@ -84,15 +159,69 @@ private:
 	std::shared_ptr<LitMaterial> m_sphereLitMaterial;
 	std::unique_ptr<Sphere> m_sphere;
 
+	// Sphere instances drawn with the sphere mesh
+	Scene m_scene;
+	SceneHandle m_sphereHandle;
+
+	// Transforms of the sphere and of the moons orbiting around it
+	struct Moon {
+		TransformHandle orbit;
+		TransformHandle body;
+		SceneHandle instance;
+		float speed;
+	};
+	TransformHierarchy m_transforms;
+	TransformHandle m_sphereNode;
+	std::vector<Moon> m_moons;
+	int m_moonCount = 0;
+	// With the lit material, the odd moons are unlit, and lit otherwise
+	bool m_mixedMaterials = false;
+	// Each moon has a material instance of its own, with another diffuse color
+	bool m_coloredMoons = false;
+	float m_orbitSpeed = 1.0f;
+
+	// Acceleration structure for picking, rebuilt when instances are added
+	// or removed and refitted when they move
+	SphereBVH m_bvh;
+	bool m_bvhDirty = true;
+	bool m_bvhMoved = false;
+	SceneHandle m_picked;
+
+	// Frames saved as capture_#####.png or .tga in the working directory
+	std::unique_ptr<FrameCapture> m_capture;
+	bool m_recording = false;
+	int m_captureFormat = 0;
+	int m_captureIndex = 0;
+
+	// GPU and CPU time of renderScene and renderImgui
+	GpuProfiler m_gpuProfiler;
+	// Camera of the frame, shared by the materials
+	FrameUniforms m_frameUniforms;
+	// Draws of the scene, refilled every frame
+	RenderQueue m_renderQueue;
+	bool m_sortDraws = true;
+	// Material instances of the scene and instances of the frame
+	static const uint32_t SphereMaterialInstance = 0;
+	MaterialTable m_materialTable;
+	InstanceBuffer m_instanceBuffer;
+	// Overlay of the RenderStats counters
+	bool m_showRenderStats = true;
+	// Frame time percentiles and frames over budget, for the window and headless modes
+	FrameTimings m_frameTimings;
+
 
     Camera cam = Camera(glm::vec3(3.0,0.0,0.0));
+    glm::mat4 m_projection = glm::mat4(1.0f);
+    glm::mat4 m_view = glm::mat4(1.0f);
+    glm::vec3 m_viewPosition = glm::vec3(0.0f, 0.0f, -1.0f);
     float m_deltaTime = 0.0f;
     float m_lastFrame = 0.0f;
 
     bool mouseRightDown = false;
+    bool mouseLeftDown = false;
     float lastX, lastY;
     bool firstMouse = true;
 
-    bool phong = false;
-    bool camEnable = true;
+    bool phong = true;
+    bool camEnable = false;
 };
@@ -9,60 +9,142 @@
  */
 
 #include "Material.h"
+#include "FrameUniforms.h"
+#include "MaterialTable.h"
+#include "Profiler.h"
 
 Material::Material()
 {
-	m_shaderProgram = std::make_unique<ShaderProgram>();
+	m_variants.resize(1u << FeatureCount);
 }
 
 bool Material::init()
 {
-	bool shaderSuccess = true;
-	shaderSuccess &= initShaders();
-	shaderSuccess &= m_shaderProgram->link();
+	return beginInit() && finishInit();
+}
+
+bool Material::beginInit()
+{
+	for (uint32_t features = 0; features < m_variants.size(); ++features)
+	{
+		if ((features & ~featureMask()) != 0)
+			continue;
+
+		Variant& variant = m_variants[features];
+		variant.program = std::make_unique<ShaderProgram>();
+		if (!initShaders(*variant.program, features) || !variant.program->beginLink()) {
+			std::cerr << "Error when loading main shader" << std::endl;
+			variant.state = InitState::Failed;
+			return false;
+		}
+		variant.state = InitState::Pending;
+	}
+	m_features &= featureMask();
+	m_shaderProgram = m_variants[m_features].program.get();
+	return true;
+}
+
+bool Material::isInitDone() const
+{
+	const Variant& variant = m_variants[m_features];
+	return variant.state != InitState::Pending || variant.program->isLinkDone();
+}
+
+bool Material::finishInit()
+{
+	return finishVariant(m_features);
+}
+
+void Material::finishCompiledVariants()
+{
+	for (uint32_t features = 0; features < m_variants.size(); ++features)
+	{
+		const Variant& variant = m_variants[features];
+		if (variant.state == InitState::Pending && variant.program->isLinkDone())
+			finishVariant(features);
+	}
+}
+
+bool Material::finishVariant(uint32_t features)
+{
+	Variant& variant = m_variants[features];
+	if (variant.state != InitState::Pending)
+		return variant.state == InitState::Ready;
+
+	variant.state = InitState::Failed;
+	bool shaderSuccess = variant.program->finishLink();
+	shaderSuccess = shaderSuccess && variant.program->bindUniformBlock(FrameUniforms::BlockName, FrameUniforms::BindingPoint);
+	shaderSuccess = shaderSuccess && variant.program->bindStorageBlock(MaterialTable::BlockName, MaterialTable::BindingPoint);
 	if (!shaderSuccess) {
 		std::cerr << "Error when loading main shader" << std::endl;
 		return false;
 	}
 
-	if (!init_impl()) return false;
+	// The attribute locations are fixed by the shaders, any variant can give them
+	if (!m_implInitialized) {
+		ShaderProgram* current = m_shaderProgram;
+		m_shaderProgram = variant.program.get();
+		m_implInitialized = init_impl();
+		m_shaderProgram = current;
+		if (!m_implInitialized) return false;
+	}
 
+	variant.state = InitState::Ready;
 	return true;
 }
 
-void Material::bind() const
+void Material::setFeatures(uint32_t features)
 {
-	m_shaderProgram->bind();
-}
+	features &= featureMask();
+	if (features == m_features)
+		return;
+	if (!m_shaderProgram) {
+		// Not initialized yet, beginInit() picks it
+		m_features = features;
+		return;
+	}
 
-bool Material::initShaders()
-{
-	bool shaderSuccess = true;
-	shaderSuccess &= m_shaderProgram->addShaderFromSource(GL_VERTEX_SHADER, directory + vertexShader());
-	shaderSuccess &= m_shaderProgram->addShaderFromSource(GL_FRAGMENT_SHADER, directory + fragmentShader());
-	if (!tessControlShader().empty()) shaderSuccess &= m_shaderProgram->addShaderFromSource(GL_TESS_CONTROL_SHADER, directory + tessControlShader());
-	if (!tessEvaluationShader().empty()) shaderSuccess &= m_shaderProgram->addShaderFromSource(GL_TESS_EVALUATION_SHADER, directory + tessEvaluationShader());
-	if (!geometryShader().empty()) shaderSuccess &= m_shaderProgram->addShaderFromSource(GL_GEOMETRY_SHADER, directory + geometryShader());
-	if (!computeShader().empty()) shaderSuccess &= m_shaderProgram->addShaderFromSource(GL_COMPUTE_SHADER, directory + computeShader());
+	if (!finishVariant(features)) {
+		std::cerr << "Variant " << features << " of the material is not available" << std::endl;
+		return;
+	}
 
-	return shaderSuccess;
+	// The new variant takes the uniforms of the previous one
+	ShaderProgram* program = m_variants[features].program.get();
+	if (m_shaderProgram && initialized())
+		program->copyUniformValues(*m_shaderProgram);
+	m_shaderProgram = program;
+	m_features = features;
 }
 
-void Material::setProjection(const glm::mat4& projection)
+void Material::bind() const
 {
-	m_shaderProgram->setMat4(projectionAttributeName, projection);
+	PROFILE_ZONE("Material::bind");
+	m_shaderProgram->bind();
 }
 
-void Material::setView(const glm::mat4& view)
+std::string Material::featureDefines(uint32_t features) const
 {
-	m_shaderProgram->setMat4(viewAttributeName, view);
+	std::string defines;
+	if (featureMask() & Blinn)
+		defines += (features & Blinn) ? "#define BLINN\n" : "#define PHONG\n";
+	return defines;
 }
 
-void Material::setViewPost(glm::vec3 viewPosition)
+bool Material::initShaders(ShaderProgram& program, uint32_t features)
 {
-    m_shaderProgram->setVec3(viewPosAttributeName, viewPosition);
+	const std::string defines = featureDefines(features);
+	bool shaderSuccess = true;
+	shaderSuccess &= program.addShaderFromSource(GL_VERTEX_SHADER, directory + vertexShader(), defines);
+	shaderSuccess &= program.addShaderFromSource(GL_FRAGMENT_SHADER, directory + fragmentShader(), defines);
+	if (!tessControlShader().empty()) shaderSuccess &= program.addShaderFromSource(GL_TESS_CONTROL_SHADER, directory + tessControlShader(), defines);
+	if (!tessEvaluationShader().empty()) shaderSuccess &= program.addShaderFromSource(GL_TESS_EVALUATION_SHADER, directory + tessEvaluationShader(), defines);
+	if (!geometryShader().empty()) shaderSuccess &= program.addShaderFromSource(GL_GEOMETRY_SHADER, directory + geometryShader(), defines);
+	if (!computeShader().empty()) shaderSuccess &= program.addShaderFromSource(GL_COMPUTE_SHADER, directory + computeShader(), defines);
+
+	return shaderSuccess;
 }
 
 void Material::setPhong(bool phong){
-    m_shaderProgram->setBool(phongAttributeName, phong);
+    setFeatures(phong ? (m_features & ~Blinn) : (m_features | Blinn));
 }
@@ -7,34 +7,77 @@
  *
  * @brief ShaderProgram wrapper that allows easy parametrization.
  *
+ * Options that change the code of the shaders (the lighting model) are
+ * features. Each combination of the features of a material is its own
+ * program, a variant compiled with a #define per feature, and the features
+ * set pick the variant used. The uniforms follow from a variant to the next.
+ *
  * Martin Johnson
  * Billy-Joe Lacasse
  * William Lebel
  */
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "ShaderProgram.h"
 
 class Material {
 public:
+	// Features of the variants, bits of a mask
+	enum Feature : uint32_t {
+		Blinn = 1 << 0, // Blinn-Phong specular instead of Phong (BLINN or PHONG)
+	};
+	static const uint32_t FeatureCount = 1;
+
+	// Attribute locations in the vertex shaders of every material
+	// (layout(location = ...)), a vertex array can be drawn with any of them
+	static const GLuint PositionLocation = 0;
+	static const GLuint NormalLocation = 1;
+	// Per instance (see InstanceBuffer): the model matrix takes 4 locations
+	static const GLuint ModelLocation = 2;
+	static const GLuint MaterialInstanceLocation = 6;
+
 	Material();
+	virtual ~Material() = default;
 
+	// Compile and link the shaders of every variant, then wait for the one
+	// of the current features
+	// return true if sucessfull
 	bool init();
+
+	// Same as init() in two steps, to compile several materials at the same
+	// time: beginInit() submits the shaders, finishInit() waits for the
+	// variant of the current features (once isInitDone(), it does not wait).
+	// The material can only be used after finishInit().
+	bool beginInit();
+	bool isInitDone() const;
+	bool finishInit();
+	inline bool initialized() const { return m_variants[m_features].state == InitState::Ready; }
+	// Finish the other variants that are compiled, without waiting
+	void finishCompiledVariants();
+
+	// Use the variant of these features (waits for it if it is not ready),
+	// the ones the material does not have are ignored
+	void setFeatures(uint32_t features);
+	inline uint32_t features() const { return m_features; }
+
 	virtual void bind() const;
+	inline GLuint programId() const { return m_shaderProgram->programId(); }
 
 	virtual GLint positionAttribLocation() const = 0;
 	virtual GLint normalAttribLocation() const = 0;
 
-	void setProjection(const glm::mat4& projection);
-	void setView(const glm::mat4& view);
-    void setViewPost(glm::vec3 viewPosition);
     void setPhong(bool phong);
 
 protected:
 	virtual bool init_impl() { return true; };
 
+	// Features changing the shaders of the material
+	virtual uint32_t featureMask() const { return 0; }
+
 	virtual inline std::string vertexShader() const = 0;
 	virtual inline std::string fragmentShader() const = 0;
 	virtual inline std::string tessControlShader() const { return ""; };
@@ -43,18 +86,27 @@ protected:
 	virtual inline std::string computeShader() const { return ""; };
 
 private:
-	bool initShaders();
+	enum class InitState { None, Pending, Ready, Failed };
+
+	struct Variant {
+		std::unique_ptr<ShaderProgram> program;
+		InitState state = InitState::None;
+	};
+
+	bool initShaders(ShaderProgram& program, uint32_t features);
+	// return true if the variant is ready
+	bool finishVariant(uint32_t features);
+	std::string featureDefines(uint32_t features) const;
 
 protected:
-	std::unique_ptr<ShaderProgram> m_shaderProgram = nullptr;
+	// Program of the current variant
+	ShaderProgram* m_shaderProgram = nullptr;
 
 private:
+	// Indexed by the features, only the combinations of featureMask() exist
+	std::vector<Variant> m_variants;
+	uint32_t m_features = 0;
+	bool m_implInitialized = false;
 	const std::string directory = SHADERS_DIR;
-
-	const std::string projectionAttributeName = "projection";
-	const std::string viewAttributeName = "view";
-	const std::string viewPosAttributeName = "viewPos";
-	const std::string phongAttributeName = "phong";
-
 };
 #endif
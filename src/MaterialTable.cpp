@@ -0,0 +1,109 @@
+/**
+ * @file MaterialTable.cpp
+ *
+ * @brief Shader storage buffer with the parameters of every material instance.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "MaterialTable.h"
+#include "GLState.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Instances of the first buffer, it doubles when the table outgrows it
+static const size_t InitialCapacity = 64;
+
+bool MaterialTable::create()
+{
+	m_capacity = 0;
+	m_refusedCapacity = 0;
+	markDirty(0, m_parameters.size());
+	return update();
+}
+
+uint32_t MaterialTable::add(const Parameters& parameters)
+{
+	m_parameters.push_back(parameters);
+	markDirty(m_parameters.size() - 1, m_parameters.size());
+	return static_cast<uint32_t>(m_parameters.size() - 1);
+}
+
+void MaterialTable::resize(size_t count)
+{
+	const size_t previous = m_parameters.size();
+	m_parameters.resize(count);
+	if (count > previous)
+		markDirty(previous, count);
+	m_dirtyEnd = std::min(m_dirtyEnd, count);
+	m_dirtyBegin = std::min(m_dirtyBegin, m_dirtyEnd);
+}
+
+void MaterialTable::set(uint32_t index, const Parameters& parameters)
+{
+	if (std::memcmp(&m_parameters[index], &parameters, sizeof(Parameters)) == 0)
+		return;
+
+	m_parameters[index] = parameters;
+	markDirty(index, index + 1);
+}
+
+bool MaterialTable::update()
+{
+	if (m_parameters.size() > m_capacity)
+	{
+		// Immutable storage can not grow, the new buffer gets every instance.
+		// The old one goes first, it does not count in the budget anymore
+		const size_t capacity = std::max(InitialCapacity, 2 * m_parameters.size());
+		const size_t bytes = capacity * sizeof(Parameters);
+		if (!GpuResourceRegistry::instance().fits(m_buffer.bytes(), bytes)) {
+			if (capacity != m_refusedCapacity)
+				std::cerr << "Material table of " << bytes << " bytes is over the GPU budget, its instances will not be drawn" << std::endl;
+			m_refusedCapacity = capacity;
+			return false;
+		}
+
+		m_buffer.reset();
+		m_buffer = GpuHandle::create(GpuResourceType::Buffer, "MaterialTable", "storage buffer");
+		m_buffer.setBytes(bytes);
+		glNamedBufferStorage(m_buffer.id(), static_cast<GLsizeiptr>(bytes), nullptr, GL_DYNAMIC_STORAGE_BIT);
+		GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, BindingPoint, m_buffer.id());
+		m_capacity = capacity;
+		markDirty(0, m_parameters.size());
+	}
+
+	if (m_dirtyBegin == m_dirtyEnd)
+		return true;
+
+	const size_t bytes = (m_dirtyEnd - m_dirtyBegin) * sizeof(Parameters);
+	glNamedBufferSubData(m_buffer.id(), static_cast<GLintptr>(m_dirtyBegin * sizeof(Parameters)), static_cast<GLsizeiptr>(bytes), &m_parameters[m_dirtyBegin]);
+	RenderStats::current().bufferBytes += bytes;
+	m_dirtyBegin = m_dirtyEnd = 0;
+	return true;
+}
+
+void MaterialTable::destroy()
+{
+	m_buffer.reset();
+	m_capacity = 0;
+}
+
+void MaterialTable::markDirty(size_t begin, size_t end)
+{
+	if (begin >= end)
+		return;
+
+	if (m_dirtyBegin == m_dirtyEnd) {
+		m_dirtyBegin = begin;
+		m_dirtyEnd = end;
+	}
+	else {
+		m_dirtyBegin = std::min(m_dirtyBegin, begin);
+		m_dirtyEnd = std::max(m_dirtyEnd, end);
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#ifndef MATERIALTABLE_H
+#define MATERIALTABLE_H
+
+/**
+ * @file MaterialTable.h
+ *
+ * @brief Shader storage buffer with the parameters of every material instance.
+ *
+ * A material instance is an index in the table. The shaders of every
+ * material declare the block as
+ *
+ *     layout(std430) readonly buffer Materials { MaterialParameters materials[]; };
+ *
+ * and read the element of the instance they draw (see InstanceBuffer), so
+ * spheres with different colors are drawn by the same program without any
+ * uniform change between them. Material::init() attaches the block to
+ * BindingPoint.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GpuResources.h"
+
+#include <cstdint>
+#include <vector>
+
+class MaterialTable {
+public:
+	static constexpr const char* BlockName = "Materials";
+	static const GLuint BindingPoint = 0;
+
+	// std430 layout of MaterialParameters. BasicMaterial only uses the diffuse color
+	struct Parameters {
+		glm::vec4 ambiant = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		glm::vec4 diffuse = glm::vec4(1.0f);
+		glm::vec3 specular = glm::vec3(1.0f);
+		float specularExponent = 0.0f;
+	};
+	static_assert(sizeof(Parameters) == 48, "Parameters must match the std430 layout of MaterialParameters");
+
+	MaterialTable() = default;
+
+	MaterialTable(const MaterialTable&) = delete;
+	MaterialTable& operator=(const MaterialTable&) = delete;
+
+	// Allocate the buffer and bind it to BindingPoint, needs a current context.
+	// return false when it does not fit in the GPU budget
+	bool create();
+
+	// Add an instance at the end of the table, return its index
+	uint32_t add(const Parameters& parameters);
+	// Remove the instances after the first count ones, or add default ones
+	void resize(size_t count);
+	// Setting the same parameters again uploads nothing
+	void set(uint32_t index, const Parameters& parameters);
+	inline const Parameters& parameters(uint32_t index) const { return m_parameters[index]; }
+	inline size_t size() const { return m_parameters.size(); }
+
+	// Upload the instances changed since the last call, before drawing.
+	// return false when the table outgrew a buffer that the GPU budget
+	// can not replace, the instances past the old buffer can not be drawn
+	bool update();
+
+	// Release the buffer, needs the context to be current
+	void destroy();
+
+private:
+	void markDirty(size_t begin, size_t end);
+
+	std::vector<Parameters> m_parameters;
+	// Range of instances to upload, empty when begin == end
+	size_t m_dirtyBegin = 0;
+	size_t m_dirtyEnd = 0;
+
+	// Immutable storage, recreated larger when the table outgrows it
+	GpuHandle m_buffer;
+	size_t m_capacity = 0;
+	// Last capacity over the budget, reported once
+	size_t m_refusedCapacity = 0;
+};
+#endif
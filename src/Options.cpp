@@ -0,0 +1,183 @@
+/**
+ * @file Options.cpp
+ *
+ * @brief Command line options of the program.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "Options.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+	bool parseInt(const char* text, int& outValue)
+	{
+		char* end = nullptr;
+		const long value = std::strtol(text, &end, 10);
+		if (end == text || *end != '\0')
+			return false;
+		outValue = static_cast<int>(value);
+		return true;
+	}
+
+	bool parseFloat(const char* text, float& outValue)
+	{
+		char* end = nullptr;
+		const float value = std::strtof(text, &end);
+		if (end == text || *end != '\0')
+			return false;
+		outValue = value;
+		return true;
+	}
+}
+
+bool parseOptions(int argc, char* argv[], Options& outOptions)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string name = argv[i];
+		if (name == "--help" || name == "-h") {
+			outOptions.help = true;
+			return true;
+		}
+
+		// Every option takes one value
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for " << name << std::endl;
+			return false;
+		}
+		const char* value = argv[++i];
+		const std::string text = value;
+
+		bool valid = true;
+		if (name == "--headless" || name == "--software" || name == "--raytrace" || name == "--benchmark") {
+			outOptions.mode = name == "--headless" ? Options::Mode::Headless
+				: name == "--software" ? Options::Mode::Software
+				: name == "--raytrace" ? Options::Mode::RayTrace
+				: Options::Mode::Benchmark;
+			outOptions.output = text;
+		}
+		else if (name == "--trace")
+			outOptions.trace = text;
+		else if (name == "--shader-cache")
+			outOptions.shaderCache = text == "off" ? std::string() : text;
+		else if (name == "--check-allocations") {
+			outOptions.mode = Options::Mode::CheckAllocations;
+			valid = parseInt(value, outOptions.checkedFrames) && outOptions.checkedFrames > 0;
+		}
+		else if (name == "--width")
+			valid = parseInt(value, outOptions.width) && outOptions.width > 0;
+		else if (name == "--height")
+			valid = parseInt(value, outOptions.height) && outOptions.height > 0;
+		else if (name == "--frames")
+			valid = parseInt(value, outOptions.frames) && outOptions.frames > 0;
+		else if (name == "--frame-time")
+			valid = parseFloat(value, outOptions.frameTime);
+		else if (name == "--samples")
+			valid = parseInt(value, outOptions.samples) && outOptions.samples > 0;
+		else if (name == "--bench-frames")
+			valid = parseInt(value, outOptions.benchmarkFrames) && outOptions.benchmarkFrames > 0;
+		else if (name == "--bench-warmup")
+			valid = parseInt(value, outOptions.benchmarkWarmup) && outOptions.benchmarkWarmup >= 0;
+		else if (name == "--check-warmup")
+			valid = parseInt(value, outOptions.checkWarmup) && outOptions.checkWarmup >= 0;
+		else if (name == "--frame-budget")
+			valid = parseFloat(value, outOptions.frameBudget) && outOptions.frameBudget > 0.0f;
+		else if (name == "--gpu-budget")
+			valid = parseFloat(value, outOptions.gpuBudget) && outOptions.gpuBudget >= 0.0f;
+		else if (name == "--material") {
+			if (text == "lit")
+				outOptions.material = Options::Material::Lit;
+			else if (text == "unlit")
+				outOptions.material = Options::Material::Unlit;
+			else if (text == "wireframe")
+				outOptions.material = Options::Material::Wireframe;
+			else
+				valid = false;
+		}
+		else if (name == "--lighting") {
+			valid = text == "phong" || text == "blinn";
+			outOptions.phong = text == "phong";
+		}
+		else if (name == "--camera") {
+			valid = text == "on" || text == "off";
+			outOptions.camera = text == "on";
+		}
+		else if (name == "--mixed-materials") {
+			valid = text == "on" || text == "off";
+			outOptions.mixedMaterials = text == "on";
+		}
+		else if (name == "--sort-draws") {
+			valid = text == "on" || text == "off";
+			outOptions.sortDraws = text == "on";
+		}
+		else if (name == "--colored-moons") {
+			valid = text == "on" || text == "off";
+			outOptions.coloredMoons = text == "on";
+		}
+		else if (name == "--radius")
+			valid = parseFloat(value, outOptions.radius) && outOptions.radius > 0.0f;
+		else if (name == "--longitude")
+			valid = parseInt(value, outOptions.longitude) && outOptions.longitude > 0;
+		else if (name == "--latitude")
+			valid = parseInt(value, outOptions.latitude) && outOptions.latitude > 0;
+		else if (name == "--moons")
+			valid = parseInt(value, outOptions.moons) && outOptions.moons >= 0 && outOptions.moons <= 64;
+		else {
+			std::cerr << "Unknown option " << name << std::endl;
+			return false;
+		}
+
+		if (!valid) {
+			std::cerr << "Invalid value '" << text << "' for " << name << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+void printUsage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options]\n"
+		<< "Output (opens a window when none is given):\n"
+		<< "  --headless <image>     OpenGL rendering without a window\n"
+		<< "  --software <image>     CPU rasterizer\n"
+		<< "  --raytrace <image>     CPU reference ray tracer\n"
+		<< "  --benchmark <file>     Sweep subdivisions, materials and lighting models\n"
+		<< "                         with OpenGL, timings written as .json or .csv\n"
+		<< "  --check-allocations <frames>\n"
+		<< "                         Render frames like the window and fail if any of them allocates\n"
+		<< "                         after the warmup, needs ENABLE_ALLOCATION_TRACKING\n"
+		<< "  --trace <file.json>    Save the profiling zones as a Chrome trace on exit,\n"
+		<< "                         needs a build with ENABLE_PROFILER\n"
+		<< "  --shader-cache <dir|off>\n"
+		<< "                         Linked shader programs saved between runs (build directory)\n"
+		<< "  --width <pixels>       Image width (900)\n"
+		<< "  --height <pixels>      Image height (900)\n"
+		<< "  --frames <count>       Headless frames to save, numbered when more than 1 (1)\n"
+		<< "  --frame-time <seconds> Animation time between headless frames (1/60)\n"
+		<< "  --samples <count>      Ray traced samples per pixel (16)\n"
+		<< "  --bench-frames <count> Measured frames per benchmark configuration (120)\n"
+		<< "  --bench-warmup <count> Frames ignored before measuring (10)\n"
+		<< "  --check-warmup <count> Frames allowed to allocate before the allocation check (10)\n"
+		<< "  --frame-budget <ms>    Frames longer than this are reported as stutters (16.7)\n"
+		<< "  --gpu-budget <MiB>     Storage allowed for buffers and render targets, 0 for no limit (0)\n"
+		<< "Scene:\n"
+		<< "  --material <lit|unlit|wireframe>\n"
+		<< "  --lighting <phong|blinn>\n"
+		<< "  --camera <on|off>      Perspective camera instead of the identity (off)\n"
+		<< "  --mixed-materials <on|off>\n"
+		<< "                         Every other moon drawn with the other material (off)\n"
+		<< "  --sort-draws <on|off>  Sort the draws by state to bind less (on)\n"
+		<< "  --colored-moons <on|off>\n"
+		<< "                         A different diffuse color for every moon (off)\n"
+		<< "  --radius <value>       Sphere radius (0.9)\n"
+		<< "  --longitude <count>    Sphere longitude subdivisions (22)\n"
+		<< "  --latitude <count>     Sphere latitude subdivisions (20)\n"
+		<< "  --moons <count>        Moons orbiting the sphere, 0 to 64 (0)\n";
+}
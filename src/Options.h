@@ -0,0 +1,65 @@
+#pragma once
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+/**
+ * @file Options.h
+ *
+ * @brief Command line options of the program.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <string>
+
+struct Options {
+	enum class Mode {
+		Window,   // Interactive window (default)
+		Headless, // OpenGL without a window, frames saved to images
+		Software, // SoftwareRenderer
+		RayTrace, // RayTracer
+		Benchmark, // Sweep of the sphere settings, timings written to JSON or CSV
+		CheckAllocations // Fails when the steady state frames allocate (see Allocations.h)
+	};
+	enum class Material { Lit, Unlit, Wireframe };
+
+	Mode mode = Mode::Window;
+	// --help was given, only the usage is printed
+	bool help = false;
+	std::string output;
+	// Chrome trace of the profiling zones, written on exit (see Profiler.h)
+	std::string trace;
+	// Directory of the program binaries, empty to always compile (see ProgramCache.h)
+	std::string shaderCache = SHADER_CACHE_DIR;
+
+	int width = 900;
+	int height = 900;
+	int frames = 1;
+	float frameTime = 1.0f / 60.0f;
+	int samples = 16;
+	int benchmarkFrames = 120;
+	int benchmarkWarmup = 10;
+	int checkedFrames = 0;
+	int checkWarmup = 10;
+	float frameBudget = 1000.0f / 60.0f; // Milliseconds, longer frames are reported as stutters
+	float gpuBudget = 0.0f;              // MiB of buffers and render targets, 0 for no limit
+
+	Material material = Material::Lit;
+	bool phong = true;
+	bool camera = false;
+	bool mixedMaterials = false; // Every other moon uses the lit or the unlit material
+	bool sortDraws = true;       // See RenderQueue
+	bool coloredMoons = false;   // A material instance per moon (see MaterialTable)
+
+	float radius = 0.9f;
+	int longitude = 22;
+	int latitude = 20;
+	int moons = 0;
+};
+
+// return true if sucessfull (also for --help, see Options::help), errors are written on std::cerr
+bool parseOptions(int argc, char* argv[], Options& outOptions);
+void printUsage(const char* program);
+#endif
@@ -0,0 +1,137 @@
+/**
+ * @file Profiler.cpp
+ *
+ * @brief Scoped CPU timing zones, saved as a Chrome trace.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "Profiler.h"
+
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct Event {
+		const char* name;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	// Events are stored in blocks that never move, so the trace can be read
+	// while threads keep recording. About a million zones per thread at most.
+	const size_t BlockSize = 4096;
+	const size_t MaxBlocks = 256;
+
+	// Only written by its thread. An event is visible to writeTrace() once
+	// committed is past it.
+	struct ThreadBuffer {
+		uint32_t threadId = 0;
+		std::unique_ptr<Event[]> blocks[MaxBlocks];
+		std::atomic<size_t> committed{ 0 };
+		std::atomic<size_t> dropped{ 0 };
+	};
+
+	// Buffers are kept after their thread ends, its zones are still in the trace
+	struct Registry {
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	};
+
+	Registry& registry()
+	{
+		static Registry instance;
+		return instance;
+	}
+
+	ThreadBuffer& threadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (!buffer) {
+			Registry& buffers = registry();
+			std::lock_guard<std::mutex> lock(buffers.mutex);
+			buffers.buffers.push_back(std::make_unique<ThreadBuffer>());
+			buffer = buffers.buffers.back().get();
+			buffer->threadId = static_cast<uint32_t>(buffers.buffers.size());
+		}
+		return *buffer;
+	}
+}
+
+namespace Profiler
+{
+	bool enabled()
+	{
+#ifdef ENABLE_PROFILER
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void record(const char* name, uint64_t start, uint64_t end)
+	{
+		ThreadBuffer& buffer = threadBuffer();
+		const size_t index = buffer.committed.load(std::memory_order_relaxed);
+		const size_t block = index / BlockSize;
+		if (block >= MaxBlocks) {
+			buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		if (!buffer.blocks[block])
+			buffer.blocks[block].reset(new Event[BlockSize]);
+		buffer.blocks[block][index % BlockSize] = Event{ name, start, end };
+		buffer.committed.store(index + 1, std::memory_order_release);
+	}
+
+	bool writeTrace(const std::string& path)
+	{
+		FILE* file = std::fopen(path.c_str(), "w");
+		if (!file) {
+			std::cerr << "Unable to open " << path << std::endl;
+			return false;
+		}
+
+		// Chrome trace event format, complete events ("X") in microseconds
+		std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+		size_t written = 0;
+		size_t dropped = 0;
+
+		Registry& buffers = registry();
+		std::lock_guard<std::mutex> lock(buffers.mutex);
+		for (const std::unique_ptr<ThreadBuffer>& buffer : buffers.buffers)
+		{
+			const size_t count = buffer->committed.load(std::memory_order_acquire);
+			dropped += buffer->dropped.load(std::memory_order_relaxed);
+			for (size_t i = 0; i < count; ++i)
+			{
+				const Event& event = buffer->blocks[i / BlockSize][i % BlockSize];
+				std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					written++ > 0 ? ",\n" : "", event.name, buffer->threadId,
+					static_cast<double>(event.start) / 1000.0, static_cast<double>(event.end - event.start) / 1000.0);
+			}
+		}
+		std::fputs("\n]}\n", file);
+
+		const bool valid = std::ferror(file) == 0;
+		std::fclose(file);
+		if (!valid) {
+			std::cerr << "Failed to write " << path << std::endl;
+			return false;
+		}
+
+		std::cout << written << " profiling zones written to " << path;
+		if (dropped > 0)
+			std::cout << " (" << dropped << " dropped, buffers full)";
+		std::cout << std::endl;
+		return true;
+	}
+}
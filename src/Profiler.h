@@ -0,0 +1,69 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/**
+ * @file Profiler.h
+ *
+ * @brief Scoped CPU timing zones, saved as a Chrome trace.
+ *
+ * PROFILE_ZONE("name") times the rest of the enclosing scope. Each thread
+ * writes its zones in its own buffer, without locks, and writeTrace() reads
+ * the zones committed so far. The trace can be opened in chrome://tracing
+ * or https://ui.perfetto.dev.
+ *
+ * The zones only exist when compiled with ENABLE_PROFILER (CMake option of
+ * the same name), otherwise the macros expand to nothing.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace Profiler
+{
+	// Whether the zones are compiled in
+	bool enabled();
+
+	// Zones recorded by every thread so far, as Chrome trace JSON.
+	// return true if sucessfull
+	bool writeTrace(const std::string& path);
+
+	// Nanoseconds since the start of the program
+	inline uint64_t now()
+	{
+		static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	// Name must be a string literal (or outlive the profiler)
+	void record(const char* name, uint64_t start, uint64_t end);
+
+	class Zone {
+	public:
+		explicit Zone(const char* name) : m_name(name), m_start(now()) {}
+		~Zone() { record(m_name, m_start, now()); }
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		const char* m_name;
+		uint64_t m_start;
+	};
+}
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) const Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#endif
+#endif
@@ -0,0 +1,181 @@
+/**
+ * @file ProgramCache.cpp
+ *
+ * @brief On-disk cache of the linked shader programs.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "ProgramCache.h"
+#include "Profiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <vector>
+
+namespace
+{
+	// Start of every file, the key is checked again in case of a collision of the names
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint32_t format;
+		uint32_t length;
+	};
+
+	const char Magic[4] = { 'G', 'L', 'P', 'B' };
+	const uint32_t Version = 1;
+	// Larger binaries are taken as a corrupt header
+	const uint32_t MaxBinaryLength = 64u * 1024u * 1024u;
+
+	// Vendor, renderer and version, the binaries only work with the driver that made them
+	std::string driverString()
+	{
+		std::string driver;
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+		{
+			const GLubyte* value = glGetString(name);
+			driver += value ? reinterpret_cast<const char*>(value) : "";
+			driver += '\n';
+		}
+		return driver;
+	}
+}
+
+ProgramCache& ProgramCache::instance()
+{
+	static ProgramCache cache;
+	return cache;
+}
+
+void ProgramCache::setDirectory(const std::string& directory)
+{
+	m_directory = directory;
+}
+
+bool ProgramCache::enabled() const
+{
+	if (m_directory.empty())
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+uint64_t ProgramCache::hash(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t value = seed;
+	for (size_t i = 0; i < size; ++i)
+		value = (value ^ bytes[i]) * 1099511628211ull;
+	return value;
+}
+
+uint64_t ProgramCache::key(const std::string& sources) const
+{
+	const std::string driver = driverString();
+	const uint64_t value = hash(driver.data(), driver.size());
+	return hash(sources.data(), sources.size(), value);
+}
+
+std::string ProgramCache::path(uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(m_directory) / name).string();
+}
+
+bool ProgramCache::load(GLuint program, uint64_t key)
+{
+	PROFILE_ZONE("ProgramCache::load");
+	const std::string file = path(key);
+	std::ifstream stream(file, std::ios::binary);
+	Header header;
+	if (!stream || !stream.read(reinterpret_cast<char*>(&header), sizeof(header))
+		|| std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.key != key) {
+		++m_misses;
+		return false;
+	}
+
+	// The length must be the rest of the file, checked before allocating it
+	std::error_code sizeError;
+	const uintmax_t fileSize = std::filesystem::file_size(file, sizeError);
+	bool valid = !sizeError && header.length > 0 && header.length <= MaxBinaryLength
+		&& fileSize == sizeof(header) + static_cast<uintmax_t>(header.length);
+
+	std::vector<char> binary;
+	if (valid) {
+		binary.resize(header.length);
+		valid = static_cast<bool>(stream.read(binary.data(), static_cast<std::streamsize>(binary.size())));
+	}
+	if (valid) {
+		glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		valid = linked == GL_TRUE;
+	}
+
+	if (!valid) {
+		// Truncated or corrupt, or the driver changed in a way its strings do not show
+		std::cerr << "Shader cache entry " << file << " rejected, compiling the program again" << std::endl;
+		stream.close();
+		std::error_code error;
+		std::filesystem::remove(file, error);
+		++m_rejected;
+		++m_misses;
+		return false;
+	}
+
+	++m_hits;
+	return true;
+}
+
+void ProgramCache::store(GLuint program, uint64_t key)
+{
+	PROFILE_ZONE("ProgramCache::store");
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	Header header;
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.key = key;
+	std::vector<char> binary(static_cast<size_t>(length));
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &written, &format, binary.data());
+	header.format = format;
+	header.length = static_cast<uint32_t>(written);
+
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+	if (error) {
+		std::cerr << "Unable to create the shader cache " << m_directory << ": " << error.message() << std::endl;
+		return;
+	}
+
+	// Written aside then renamed, another instance never reads half a file
+	const std::string file = path(key);
+	const std::string temporary = file + ".tmp";
+	{
+		std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(binary.data(), written);
+		if (!stream) {
+			std::cerr << "Unable to write " << temporary << std::endl;
+			return;
+		}
+	}
+	std::filesystem::rename(temporary, file, error);
+	if (error)
+		std::cerr << "Unable to write " << file << ": " << error.message() << std::endl;
+}
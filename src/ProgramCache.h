@@ -0,0 +1,70 @@
+#pragma once
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+/**
+ * @file ProgramCache.h
+ *
+ * @brief On-disk cache of the linked shader programs.
+ *
+ * ShaderProgram::link() looks for a binary of the program, saved by
+ * glGetProgramBinary, before compiling its sources. A binary is found by a
+ * key hashing the final sources (with their #defines) and the vendor,
+ * renderer and version of the driver, so a driver update or an edited
+ * shader misses. A binary the driver rejects anyway is deleted and the
+ * program is compiled again.
+ *
+ * Only the thread of the context may use it.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class ProgramCache {
+public:
+	static ProgramCache& instance();
+
+	ProgramCache(const ProgramCache&) = delete;
+	ProgramCache& operator=(const ProgramCache&) = delete;
+
+	// Directory of the binaries, created when needed. Empty disables the cache
+	void setDirectory(const std::string& directory);
+	inline const std::string& directory() const { return m_directory; }
+
+	// Whether programs can be loaded and saved, needs a current context
+	bool enabled() const;
+
+	// Key of a program from all its sources, for the current driver
+	uint64_t key(const std::string& sources) const;
+
+	// Give its saved binary to a new program.
+	// return true if sucessfull, the program is then linked
+	bool load(GLuint program, uint64_t key);
+	// Save the binary of a linked program (retrievable hint set before linking)
+	void store(GLuint program, uint64_t key);
+
+	inline size_t hits() const { return m_hits; }
+	inline size_t misses() const { return m_misses; }
+	inline size_t rejected() const { return m_rejected; }
+
+	// FNV-1a, 64 bits
+	static uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+private:
+	ProgramCache() = default;
+
+	std::string path(uint64_t key) const;
+
+	std::string m_directory;
+	size_t m_hits = 0;
+	size_t m_misses = 0;
+	size_t m_rejected = 0;
+};
+#endif
@@ -0,0 +1,305 @@
+/**
+ * @file RayTracer.cpp
+ *
+ * @brief Reference renderer tracing rays against analytic spheres.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "RayTracer.h"
+#include "Profiler.h"
+#include "Simd.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	// Radical inverse, used to spread the samples inside the pixels
+	float halton(int index, int base)
+	{
+		float result = 0.0f;
+		float fraction = 1.0f / base;
+		for (; index > 0; index /= base, fraction /= base)
+			result += fraction * (index % base);
+		return result;
+	}
+}
+
+RayTracer::RayTracer(int width, int height, ThreadPool& threadPool) :
+	m_threadPool(threadPool)
+{
+	resize(width, height);
+}
+
+void RayTracer::resize(int width, int height)
+{
+	m_width = std::max(1, width);
+	m_height = std::max(1, height);
+	m_tilesX = (m_width + TileSize - 1) / TileSize;
+	m_tilesY = (m_height + TileSize - 1) / TileSize;
+
+	m_accumulation.assign(static_cast<size_t>(m_width) * m_height, glm::vec4(0.0f));
+	m_color.assign(static_cast<size_t>(m_width) * m_height, 0);
+	m_tileSpheres.assign(static_cast<size_t>(m_tilesX) * m_tilesY, std::vector<uint32_t>());
+	m_samples = 0;
+	cullTiles();
+}
+
+void RayTracer::setParameters(const ShadingParameters& parameters)
+{
+	m_parameters = parameters;
+	reset();
+}
+
+void RayTracer::setCamera(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPosition)
+{
+	// The vertex shaders mirror the z axis before applying the view
+	const glm::mat4 mirrorZ = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 1.0f, -1.0f));
+	m_inverseViewProjection = glm::inverse(projection * view * mirrorZ);
+	m_viewPosition = viewPosition;
+	cullTiles();
+	reset();
+}
+
+void RayTracer::setScene(const Scene& scene)
+{
+	m_sphereX.clear();
+	m_sphereY.clear();
+	m_sphereZ.clear();
+	m_sphereRadius.clear();
+	for (uint32_t index = 0; index < scene.size(); ++index)
+	{
+		if (!(scene.denseFlags(index) & Scene::Enabled))
+			continue;
+
+		const glm::vec3 position = scene.densePosition(index);
+		m_sphereX.push_back(position.x);
+		m_sphereY.push_back(position.y);
+		m_sphereZ.push_back(position.z);
+		m_sphereRadius.push_back(scene.denseRadius(index));
+	}
+	cullTiles();
+	reset();
+}
+
+void RayTracer::reset()
+{
+	std::fill(m_accumulation.begin(), m_accumulation.end(), glm::vec4(0.0f));
+	m_samples = 0;
+}
+
+void RayTracer::renderPass()
+{
+	// First sample at the pixel centers, like the rasterizers
+	const glm::vec2 jitter = m_samples == 0 ? glm::vec2(0.5f) : glm::vec2(halton(m_samples, 2), halton(m_samples, 3));
+
+	m_threadPool.parallelFor(m_tileSpheres.size(), [&](size_t tile) { renderTile(static_cast<int>(tile), jitter); });
+	++m_samples;
+}
+
+RayTracer::Statistics RayTracer::render(int samples)
+{
+	Statistics statistics;
+	statistics.cores = m_threadPool.threadCount() + 1;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	while (m_samples < samples)
+	{
+		renderPass();
+		++statistics.passes;
+	}
+	statistics.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	if (statistics.passes > 0 && statistics.seconds > 0.0)
+	{
+		statistics.raysPerSecond = static_cast<double>(m_width) * m_height * statistics.passes / statistics.seconds;
+		statistics.imagesPerSecondPerCore = statistics.passes / statistics.seconds / statistics.cores;
+	}
+	return statistics;
+}
+
+const uint8_t* RayTracer::resolve()
+{
+	const float scale = m_samples > 0 ? 1.0f / m_samples : 0.0f;
+	for (size_t i = 0; i < m_accumulation.size(); ++i)
+		m_color[i] = packColor(m_accumulation[i] * scale);
+	return reinterpret_cast<const uint8_t*>(m_color.data());
+}
+
+RayTracer::TileFrustum RayTracer::tileFrustum(int minX, int minY, int maxX, int maxY) const
+{
+	auto unproject = [this](float x, float y, float z) {
+		const glm::vec4 point = m_inverseViewProjection * glm::vec4(2.0f * x / m_width - 1.0f, 1.0f - 2.0f * y / m_height, z, 1.0f);
+		return glm::vec3(point) / point.w;
+	};
+
+	// One pixel of margin for the jitter
+	const glm::vec2 corners[4] = {
+		glm::vec2(minX - 1, minY - 1), glm::vec2(maxX + 1, minY - 1),
+		glm::vec2(maxX + 1, maxY + 1), glm::vec2(minX - 1, maxY + 1)
+	};
+	glm::vec3 nearPoints[4], farPoints[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		nearPoints[i] = unproject(corners[i].x, corners[i].y, -1.0f);
+		farPoints[i] = unproject(corners[i].x, corners[i].y, 1.0f);
+	}
+	const glm::vec3 inside = 0.5f * (unproject(0.5f * (minX + maxX), 0.5f * (minY + maxY), -1.0f) + unproject(0.5f * (minX + maxX), 0.5f * (minY + maxY), 1.0f));
+
+	// Each side plane contains the rays of two consecutive corners, which
+	// works for perspective and orthographic projections alike
+	TileFrustum frustum;
+	for (int i = 0; i < 4; ++i)
+	{
+		const int next = (i + 1) % 4;
+		glm::vec3 normal = glm::normalize(glm::cross(farPoints[i] - nearPoints[i], nearPoints[next] - nearPoints[i]));
+		if (glm::dot(normal, inside - nearPoints[i]) < 0.0f)
+			normal = -normal;
+		frustum.planes[i] = glm::vec4(normal, -glm::dot(normal, nearPoints[i]));
+	}
+	return frustum;
+}
+
+void RayTracer::cullTiles()
+{
+	m_threadPool.parallelFor(m_tileSpheres.size(), [this](size_t tile) { cullTile(static_cast<int>(tile)); });
+}
+
+void RayTracer::cullTile(int tile)
+{
+	const int minX = (tile % m_tilesX) * TileSize;
+	const int minY = (tile / m_tilesX) * TileSize;
+	const int maxX = std::min(m_width, minX + TileSize);
+	const int maxY = std::min(m_height, minY + TileSize);
+
+	// Keep the spheres that can be seen from this tile, for any jitter
+	std::vector<uint32_t>& spheres = m_tileSpheres[tile];
+	spheres.clear();
+	const TileFrustum frustum = tileFrustum(minX, minY, maxX, maxY);
+	for (uint32_t s = 0; s < m_sphereRadius.size(); ++s)
+	{
+		const glm::vec3 center(m_sphereX[s], m_sphereY[s], m_sphereZ[s]);
+		bool visible = true;
+		for (const glm::vec4& plane : frustum.planes)
+			visible = visible && glm::dot(glm::vec3(plane), center) + plane.w >= -m_sphereRadius[s];
+		if (visible)
+			spheres.push_back(s);
+	}
+}
+
+void RayTracer::renderTile(int tile, const glm::vec2& jitter)
+{
+	PROFILE_ZONE("RayTracer::renderTile");
+	const int minX = (tile % m_tilesX) * TileSize;
+	const int minY = (tile / m_tilesX) * TileSize;
+	const int maxX = std::min(m_width, minX + TileSize);
+	const int maxY = std::min(m_height, minY + TileSize);
+
+	const std::vector<uint32_t>& spheres = m_tileSpheres[tile];
+	if (spheres.empty())
+		return;
+
+	const glm::mat4& m = m_inverseViewProjection;
+	const SimdFloat zero(0.0f);
+	const SimdFloat noHit(-1.0f);
+	const SimdFloat lanes = SimdFloat::lanes() + SimdFloat(jitter.x);
+	const SimdFloat endX(static_cast<float>(maxX));
+	const SimdFloat ndcScaleX(2.0f / m_width);
+
+	for (int y = minY; y < maxY; ++y)
+	{
+		const float ndcY = 1.0f - 2.0f * (static_cast<float>(y) + jitter.y) / m_height;
+
+		for (int x = minX; x < maxX; x += SimdFloat::Width)
+		{
+			// Packet of rays from the near plane to the far plane
+			const SimdFloat px = SimdFloat(static_cast<float>(x)) + lanes;
+			const SimdFloat ndcX = px * ndcScaleX - SimdFloat(1.0f);
+
+			SimdFloat nearPoint[4], farPoint[4];
+			for (int r = 0; r < 4; ++r)
+			{
+				const SimdFloat rowBase = ndcX * SimdFloat(m[0][r]) + SimdFloat(ndcY * m[1][r] + m[3][r]);
+				nearPoint[r] = rowBase - SimdFloat(m[2][r]);
+				farPoint[r] = rowBase + SimdFloat(m[2][r]);
+			}
+			const SimdFloat invNearW = SimdFloat(1.0f) / nearPoint[3];
+			const SimdFloat invFarW = SimdFloat(1.0f) / farPoint[3];
+			const SimdFloat ox = nearPoint[0] * invNearW, oy = nearPoint[1] * invNearW, oz = nearPoint[2] * invNearW;
+			SimdFloat dx = farPoint[0] * invFarW - ox, dy = farPoint[1] * invFarW - oy, dz = farPoint[2] * invFarW - oz;
+			const SimdFloat length = simdSqrt(dx * dx + dy * dy + dz * dz);
+			const SimdFloat invLength = SimdFloat(1.0f) / length;
+			dx *= invLength;
+			dy *= invLength;
+			dz *= invLength;
+
+			// Closest sphere of each ray, indices are exact as floats below 2^24
+			SimdFloat closest = length;
+			SimdFloat hitSphere = noHit;
+			for (uint32_t s : spheres)
+			{
+				const SimdFloat ocx = ox - SimdFloat(m_sphereX[s]);
+				const SimdFloat ocy = oy - SimdFloat(m_sphereY[s]);
+				const SimdFloat ocz = oz - SimdFloat(m_sphereZ[s]);
+				const SimdFloat b = ocx * dx + ocy * dy + ocz * dz;
+				const SimdFloat c = ocx * ocx + ocy * ocy + ocz * ocz - SimdFloat(m_sphereRadius[s] * m_sphereRadius[s]);
+				const SimdFloat discriminant = b * b - c;
+				const SimdMask intersects = discriminant >= zero;
+				if (!intersects.any())
+					continue;
+
+				// Back faces are drawn too, the far side is seen from inside
+				const SimdFloat root = simdSqrt(simdMax(discriminant, zero));
+				const SimdFloat tNear = -b - root;
+				const SimdFloat t = simdSelect(tNear >= zero, tNear, root - b);
+				const SimdMask closer = intersects & (t >= zero) & (t < closest);
+				closest = simdSelect(closer, t, closest);
+				hitSphere = simdSelect(closer, SimdFloat(static_cast<float>(s)), hitSphere);
+			}
+
+			int hits = ((hitSphere >= zero) & (px < endX)).bits();
+			if (!hits)
+				continue;
+
+			alignas(32) float originX[SimdFloat::Width], originY[SimdFloat::Width], originZ[SimdFloat::Width];
+			alignas(32) float directionX[SimdFloat::Width], directionY[SimdFloat::Width], directionZ[SimdFloat::Width];
+			alignas(32) float distances[SimdFloat::Width], sphereIndices[SimdFloat::Width];
+			ox.store(originX);
+			oy.store(originY);
+			oz.store(originZ);
+			dx.store(directionX);
+			dy.store(directionY);
+			dz.store(directionZ);
+			closest.store(distances);
+			hitSphere.store(sphereIndices);
+
+			glm::vec4* row = m_accumulation.data() + static_cast<size_t>(y) * m_width + x;
+			while (hits)
+			{
+				const int lane = lowestLane(hits);
+				hits &= hits - 1;
+
+				const uint32_t s = static_cast<uint32_t>(sphereIndices[lane]);
+				const glm::vec3 position = glm::vec3(originX[lane], originY[lane], originZ[lane]) + distances[lane] * glm::vec3(directionX[lane], directionY[lane], directionZ[lane]);
+				// Samples are clamped as they would be in the framebuffer
+				row[lane] += glm::clamp(shade(position, glm::vec3(m_sphereX[s], m_sphereY[s], m_sphereZ[s])), 0.0f, 1.0f);
+			}
+		}
+	}
+}
+
+glm::vec4 RayTracer::shade(const glm::vec3& position, const glm::vec3& center) const
+{
+	if (m_parameters.shading != ShadingModel::Lit)
+		return basicShader(m_parameters);
+
+	// Same varyings as litShader.vert
+	const glm::vec3 ajustedViewPos = m_viewPosition - position;
+	const glm::vec3 fEyeVector = glm::vec3(ajustedViewPos.x, ajustedViewPos.y, -ajustedViewPos.z);
+	return litShader(m_parameters, position - center, fEyeVector, position);
+}
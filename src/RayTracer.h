@@ -0,0 +1,100 @@
+#pragma once
+#ifndef RAYTRACER_H
+#define RAYTRACER_H
+
+/**
+ * @file RayTracer.h
+ *
+ * @brief Reference renderer tracing rays against analytic spheres.
+ *
+ * Rays are traced in packets of SimdFloat::Width pixels and hits are shaded
+ * with ShaderPorts.h, so the result is what the lit material would show for
+ * a perfectly tessellated sphere. Each pass adds one jittered sample per
+ * pixel to an accumulation buffer, tiles of the image being spread over the
+ * thread pool.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Scene.h"
+#include "ShaderPorts.h"
+#include "ThreadPool.h"
+
+class RayTracer {
+public:
+	struct Statistics {
+		int passes = 0;
+		double seconds = 0.0;
+		unsigned int cores = 1;
+		double raysPerSecond = 0.0;
+		double imagesPerSecondPerCore = 0.0;
+	};
+
+	static const int TileSize = 32;
+
+	RayTracer(int width, int height, ThreadPool& threadPool = ThreadPool::global());
+
+	void resize(int width, int height);
+	inline int width() const { return m_width; }
+	inline int height() const { return m_height; }
+
+	// Changing any of these restarts the accumulation.
+	// Wireframe is shaded as unlit since there are no triangles to outline.
+	void setParameters(const ShadingParameters& parameters);
+	void setCamera(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPosition);
+	// Copy the enabled instances of the scene
+	void setScene(const Scene& scene);
+	void reset();
+
+	// Add one sample per pixel
+	void renderPass();
+	// Add passes until the given number of samples per pixel is reached
+	Statistics render(int samples);
+	inline int samples() const { return m_samples; }
+
+	// Average of the samples as RGBA8, rows from top to bottom
+	const uint8_t* resolve();
+
+private:
+	struct TileFrustum {
+		glm::vec4 planes[4];
+	};
+
+	// Fill m_tileSpheres from the camera and the spheres
+	void cullTiles();
+	void cullTile(int tile);
+	void renderTile(int tile, const glm::vec2& jitter);
+	TileFrustum tileFrustum(int minX, int minY, int maxX, int maxY) const;
+	glm::vec4 shade(const glm::vec3& position, const glm::vec3& center) const;
+
+	ThreadPool& m_threadPool;
+
+	int m_width = 0;
+	int m_height = 0;
+	int m_tilesX = 0;
+	int m_tilesY = 0;
+
+	ShadingParameters m_parameters;
+	glm::mat4 m_inverseViewProjection = glm::mat4(1.0f);
+	glm::vec3 m_viewPosition = glm::vec3(0.0f);
+
+	// Spheres, one array per component for the packet tests
+	std::vector<float> m_sphereX;
+	std::vector<float> m_sphereY;
+	std::vector<float> m_sphereZ;
+	std::vector<float> m_sphereRadius;
+	// Spheres overlapping each tile, rebuilt when the size, camera or scene changes
+	std::vector<std::vector<uint32_t>> m_tileSpheres;
+
+	std::vector<glm::vec4> m_accumulation;
+	std::vector<uint32_t> m_color;
+	int m_samples = 0;
+};
+#endif
@@ -0,0 +1,196 @@
+/**
+ * @file RenderQueue.cpp
+ *
+ * @brief Draws of a frame, sorted to change the OpenGL state as little as possible.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "RenderQueue.h"
+#include "Material.h"
+#include "Sphere.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+static const int RadixBits = 8;
+static const size_t RadixBins = 1u << RadixBits;
+// Smallest part of the queue given to a thread
+static const size_t MinChunkPackets = 4096;
+
+uint64_t RenderQueue::makeKey(uint32_t layer, uint32_t program, uint32_t material, uint32_t vertexArray, float depth)
+{
+	const uint64_t depthMax = (1ull << DepthBits) - 1;
+	const uint64_t quantized = static_cast<uint64_t>(glm::clamp(depth, 0.0f, 1.0f) * static_cast<float>(depthMax));
+
+	uint64_t key = layer & ((1u << LayerBits) - 1);
+	key = (key << ProgramBits) | (program & ((1u << ProgramBits) - 1));
+	key = (key << MaterialBits) | (material & ((1u << MaterialBits) - 1));
+	key = (key << VertexArrayBits) | (vertexArray & ((1u << VertexArrayBits) - 1));
+	key = (key << DepthBits) | std::min(quantized, depthMax);
+	return key;
+}
+
+void RenderQueue::clear()
+{
+	m_keys.clear();
+	m_packets.clear();
+	m_sorted = false;
+}
+
+void RenderQueue::reserve(size_t count)
+{
+	m_keys.reserve(count);
+	m_packets.reserve(count);
+	m_instances.reserve(count);
+	for (int i = 0; i < 2; ++i)
+	{
+		m_sortKeys[i].reserve(count);
+		m_sortOrder[i].reserve(count);
+	}
+	// At most one histogram per MinChunkPackets, see sort
+	m_histograms.reserve(std::max<size_t>(1, count / MinChunkPackets) * RadixBins);
+}
+
+void RenderQueue::push(uint64_t key, const Packet& packet)
+{
+	m_keys.push_back(key);
+	m_packets.push_back(packet);
+	m_sorted = false;
+}
+
+void RenderQueue::sort(ThreadPool* pool)
+{
+	PROFILE_ZONE("RenderQueue::sort");
+	const size_t count = m_keys.size();
+	m_current = 0;
+	m_sortKeys[0].assign(m_keys.begin(), m_keys.end());
+	m_sortOrder[0].resize(count);
+	for (size_t i = 0; i < count; ++i)
+		m_sortOrder[0][i] = static_cast<uint32_t>(i);
+	m_sortKeys[1].resize(count);
+	m_sortOrder[1].resize(count);
+	m_sorted = true;
+	if (count < 2)
+		return;
+
+	// Bytes equal in every key are already sorted, they need no pass
+	uint64_t varying = 0;
+	for (size_t i = 1; i < count; ++i)
+		varying |= m_keys[i] ^ m_keys[0];
+
+	m_chunkCount = 1;
+	if (pool && count >= ParallelSortPackets)
+		m_chunkCount = std::max<size_t>(1, std::min<size_t>(pool->threadCount() + 1, count / MinChunkPackets));
+	m_histograms.resize(m_chunkCount * RadixBins);
+
+	for (int shift = 0; shift < 64; shift += RadixBits)
+	{
+		if ((varying >> shift) & (RadixBins - 1))
+			radixPass(pool, shift);
+	}
+}
+
+void RenderQueue::radixPass(ThreadPool* pool, int shift)
+{
+	if (m_chunkCount > 1)
+		pool->parallelFor(m_chunkCount, [this, shift](size_t chunk) { countDigits(chunk, shift); });
+	else
+		countDigits(0, shift);
+
+	// Offsets in the output: by byte value, then by chunk so that the sort is stable
+	uint32_t offset = 0;
+	for (size_t bin = 0; bin < RadixBins; ++bin)
+	{
+		for (size_t chunk = 0; chunk < m_chunkCount; ++chunk)
+		{
+			uint32_t& entry = m_histograms[chunk * RadixBins + bin];
+			const uint32_t binCount = entry;
+			entry = offset;
+			offset += binCount;
+		}
+	}
+
+	if (m_chunkCount > 1)
+		pool->parallelFor(m_chunkCount, [this, shift](size_t chunk) { scatterDigits(chunk, shift); });
+	else
+		scatterDigits(0, shift);
+
+	m_current = 1 - m_current;
+}
+
+void RenderQueue::countDigits(size_t chunk, int shift)
+{
+	uint32_t* histogram = &m_histograms[chunk * RadixBins];
+	std::fill(histogram, histogram + RadixBins, 0u);
+
+	const uint64_t* keys = m_sortKeys[m_current].data();
+	const size_t end = chunkBegin(chunk + 1);
+	for (size_t i = chunkBegin(chunk); i < end; ++i)
+		++histogram[(keys[i] >> shift) & (RadixBins - 1)];
+}
+
+void RenderQueue::scatterDigits(size_t chunk, int shift)
+{
+	uint32_t* offsets = &m_histograms[chunk * RadixBins];
+	const uint64_t* keys = m_sortKeys[m_current].data();
+	const uint32_t* order = m_sortOrder[m_current].data();
+	uint64_t* outKeys = m_sortKeys[1 - m_current].data();
+	uint32_t* outOrder = m_sortOrder[1 - m_current].data();
+
+	const size_t end = chunkBegin(chunk + 1);
+	for (size_t i = chunkBegin(chunk); i < end; ++i)
+	{
+		const uint32_t destination = offsets[(keys[i] >> shift) & (RadixBins - 1)]++;
+		outKeys[destination] = keys[i];
+		outOrder[destination] = order[i];
+	}
+}
+
+void RenderQueue::submit(InstanceBuffer& instances)
+{
+	PROFILE_ZONE("RenderQueue::submit");
+	const uint32_t* order = m_sorted ? m_sortOrder[m_current].data() : nullptr;
+	const size_t count = m_packets.size();
+
+	m_instances.clear();
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Packet& packet = m_packets[order ? order[i] : i];
+		m_instances.push_back({ packet.model, packet.materialInstance });
+	}
+	if (!instances.upload(m_instances))
+		return;
+
+	// Each run of packets with the same material and mesh is one draw
+	const Material* bound = nullptr;
+	Sphere* mesh = nullptr;
+	size_t first = 0;
+	for (size_t i = 1; i <= count; ++i)
+	{
+		const Packet& packet = m_packets[order ? order[first] : first];
+		if (i < count)
+		{
+			const Packet& next = m_packets[order ? order[i] : i];
+			if (next.material == packet.material && next.mesh == packet.mesh)
+				continue;
+		}
+
+		if (packet.material != bound)
+		{
+			packet.material->bind();
+			bound = packet.material;
+		}
+		if (packet.mesh != mesh)
+		{
+			mesh = packet.mesh;
+			mesh->setInstanceBuffer(instances.id(), instances.offset());
+		}
+		mesh->draw(static_cast<GLuint>(first), static_cast<GLsizei>(i - first));
+		first = i;
+	}
+	instances.fence();
+}
@@ -0,0 +1,103 @@
+#pragma once
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+/**
+ * @file RenderQueue.h
+ *
+ * @brief Draws of a frame, sorted to change the OpenGL state as little as possible.
+ *
+ * Every draw is a packet with a 64-bit key. From the most significant bits:
+ * layer, program, material, vertex array and depth. Sorting the keys groups
+ * the draws that use the same program, then the same material and the same
+ * vertex array, and orders each group front to back. The sort is a radix
+ * sort (one pass per byte that differs between the keys), spread over a
+ * ThreadPool for the large queues.
+ *
+ * The material of the key is the Material object: its instances (see
+ * MaterialTable) only change an index per instance. Consecutive packets with
+ * the same material and mesh are submitted as a single instanced draw.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "InstanceBuffer.h"
+
+class Material;
+class Sphere;
+class ThreadPool;
+
+class RenderQueue {
+public:
+	// Draw of a mesh with a material instance (index in the MaterialTable)
+	struct Packet {
+		Material* material;
+		Sphere* mesh;
+		glm::mat4 model;
+		uint32_t materialInstance;
+	};
+
+	// Bits of the key fields, the ids are truncated to them
+	static const int LayerBits = 4;
+	static const int ProgramBits = 12;
+	static const int MaterialBits = 12;
+	static const int VertexArrayBits = 12;
+	static const int DepthBits = 24;
+
+	// Layers are drawn in increasing order
+	static const uint32_t OpaqueLayer = 0;
+
+	// Depth in [0, 1] from the near plane, clamped
+	static uint64_t makeKey(uint32_t layer, uint32_t program, uint32_t material, uint32_t vertexArray, float depth);
+
+	// Keeps the memory, the frames after the first ones do not allocate
+	void clear();
+	void reserve(size_t count);
+	void push(uint64_t key, const Packet& packet);
+	inline size_t size() const { return m_packets.size(); }
+
+	// Order the packets by key, packets with the same key keep the order they
+	// were pushed in. The pool is only used above ParallelSortPackets.
+	void sort(ThreadPool* pool = nullptr);
+
+	// Write the instances of the packets in the buffer and draw them, in key
+	// order when sorted, in push order otherwise. A material is bound when
+	// it changes, the mesh binds its vertex array. The buffer is fenced after
+	// the draws. Nothing is drawn when the instances do not fit in the buffer.
+	void submit(InstanceBuffer& instances);
+
+	// Below this many packets, waking the threads costs more than it saves
+	static const size_t ParallelSortPackets = 16384;
+
+private:
+	// One pass of the radix sort, on the byte at shift, from m_sortKeys[m_current]
+	void radixPass(ThreadPool* pool, int shift);
+	void countDigits(size_t chunk, int shift);
+	void scatterDigits(size_t chunk, int shift);
+	inline size_t chunkBegin(size_t chunk) const { return m_keys.size() * chunk / m_chunkCount; }
+
+	std::vector<uint64_t> m_keys;
+	std::vector<Packet> m_packets;
+	// Instances of the packets in draw order, for the InstanceBuffer
+	std::vector<InstanceBuffer::Instance> m_instances;
+
+	// Keys and packet indices being sorted, the pass reads from m_current
+	// and writes to the other one
+	std::vector<uint64_t> m_sortKeys[2];
+	std::vector<uint32_t> m_sortOrder[2];
+	int m_current = 0;
+	bool m_sorted = false;
+
+	// Count of each byte value per chunk, then the chunk offsets in the output
+	std::vector<uint32_t> m_histograms;
+	size_t m_chunkCount = 1;
+};
+#endif
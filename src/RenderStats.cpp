@@ -0,0 +1,33 @@
+/**
+ * @file RenderStats.cpp
+ *
+ * @brief Counters of the OpenGL work submitted during a frame.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "RenderStats.h"
+
+namespace
+{
+	RenderStats currentFrame;
+	RenderStats lastFrame;
+}
+
+RenderStats& RenderStats::current()
+{
+	return currentFrame;
+}
+
+const RenderStats& RenderStats::last()
+{
+	return lastFrame;
+}
+
+void RenderStats::endFrame()
+{
+	lastFrame = currentFrame;
+	currentFrame = RenderStats();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+/**
+ * @file RenderStats.h
+ *
+ * @brief Counters of the OpenGL work submitted during a frame.
+ *
+ * The classes that call OpenGL (Sphere, ShaderProgram, materials) add to the
+ * counters of the current frame, endFrame() keeps them as the last frame
+ * ones and starts again from zero. Only the rendering thread counts.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <cstdint>
+
+struct RenderStats {
+	uint64_t drawCalls = 0;
+	uint64_t triangles = 0;
+	uint64_t vertices = 0;       // Indices drawn, the vertices shaded without post-transform cache
+	uint64_t programBinds = 0;
+	uint64_t vaoBinds = 0;
+	uint64_t uniformUploads = 0;
+	uint64_t uniformSkips = 0;   // Set to the value the program already had
+	uint64_t bufferBytes = 0;    // Uploaded with glBufferData / glBufferSubData
+	uint64_t stateChanges = 0;   // Fixed function state (polygon mode, depth test, ...)
+	uint64_t redundantStates = 0; // Changes to the current value, filtered by GLState
+
+	// Counters of the frame being rendered
+	static RenderStats& current();
+	// Counters of the last complete frame
+	static const RenderStats& last();
+	// The current counters become the last ones
+	static void endFrame();
+};
+#endif
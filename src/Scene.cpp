@@ -0,0 +1,329 @@
+/**
+ * @file Scene.cpp
+ *
+ * @brief Data-oriented container of sphere instances.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "Scene.h"
+
+#include <algorithm>
+#include <cassert>
+
+static const uint32_t InvalidIndex = ~0u;
+
+Scene::Scene()
+{
+	// Default levels of detail: full tessellation up close, coarser further away
+	setLodDistances({ 8.0f, 32.0f, 128.0f });
+}
+
+void Scene::reserve(size_t count)
+{
+	m_positionX.reserve(count);
+	m_positionY.reserve(count);
+	m_positionZ.reserve(count);
+	m_radius.reserve(count);
+	m_materialId.reserve(count);
+	m_materialInstance.reserve(count);
+	m_lod.reserve(count);
+	m_flags.reserve(count);
+	m_denseToSlot.reserve(count);
+	m_slotToDense.reserve(count);
+	m_slotGeneration.reserve(count);
+	m_drawList.reserve(count);
+}
+
+void Scene::clear()
+{
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_radius.clear();
+	m_materialId.clear();
+	m_materialInstance.clear();
+	m_lod.clear();
+	m_flags.clear();
+	m_denseToSlot.clear();
+	m_drawList.clear();
+
+	// Keep the generations so that handles given before the clear stay invalid
+	m_freeSlot = InvalidIndex;
+	for (uint32_t slot = 0; slot < m_slotToDense.size(); ++slot)
+	{
+		++m_slotGeneration[slot];
+		m_slotToDense[slot] = m_freeSlot;
+		m_freeSlot = slot;
+	}
+}
+
+SceneHandle Scene::create(const glm::vec3& position, float radius, uint32_t materialId, uint32_t materialInstance)
+{
+	const uint32_t dense = static_cast<uint32_t>(m_radius.size());
+
+	uint32_t slot;
+	if (m_freeSlot != InvalidIndex)
+	{
+		slot = m_freeSlot;
+		m_freeSlot = m_slotToDense[slot];
+		m_slotToDense[slot] = dense;
+	}
+	else
+	{
+		slot = static_cast<uint32_t>(m_slotToDense.size());
+		m_slotToDense.push_back(dense);
+		m_slotGeneration.push_back(0);
+	}
+
+	m_positionX.push_back(position.x);
+	m_positionY.push_back(position.y);
+	m_positionZ.push_back(position.z);
+	m_radius.push_back(radius);
+	m_materialId.push_back(materialId);
+	m_materialInstance.push_back(materialInstance);
+	m_lod.push_back(0);
+	m_flags.push_back(Enabled | Visible);
+	m_denseToSlot.push_back(slot);
+	// Room for every instance, buildDrawList() must not allocate when more become visible
+	m_drawList.reserve(m_radius.capacity());
+
+	SceneHandle handle;
+	handle.slot = slot;
+	handle.generation = m_slotGeneration[slot];
+	return handle;
+}
+
+bool Scene::destroy(SceneHandle handle)
+{
+	const uint32_t dense = denseIndex(handle);
+	if (dense == InvalidIndex)
+		return false;
+
+	// Move the last instance in the hole to keep the arrays packed
+	const uint32_t last = static_cast<uint32_t>(m_radius.size() - 1);
+	if (dense != last)
+	{
+		m_positionX[dense] = m_positionX[last];
+		m_positionY[dense] = m_positionY[last];
+		m_positionZ[dense] = m_positionZ[last];
+		m_radius[dense] = m_radius[last];
+		m_materialId[dense] = m_materialId[last];
+		m_materialInstance[dense] = m_materialInstance[last];
+		m_lod[dense] = m_lod[last];
+		m_flags[dense] = m_flags[last];
+		m_denseToSlot[dense] = m_denseToSlot[last];
+		m_slotToDense[m_denseToSlot[dense]] = dense;
+	}
+
+	m_positionX.pop_back();
+	m_positionY.pop_back();
+	m_positionZ.pop_back();
+	m_radius.pop_back();
+	m_materialId.pop_back();
+	m_materialInstance.pop_back();
+	m_lod.pop_back();
+	m_flags.pop_back();
+	m_denseToSlot.pop_back();
+
+	++m_slotGeneration[handle.slot];
+	m_slotToDense[handle.slot] = m_freeSlot;
+	m_freeSlot = handle.slot;
+
+	return true;
+}
+
+bool Scene::isValid(SceneHandle handle) const
+{
+	return denseIndex(handle) != InvalidIndex;
+}
+
+void Scene::setPosition(SceneHandle handle, const glm::vec3& position)
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	m_positionX[dense] = position.x;
+	m_positionY[dense] = position.y;
+	m_positionZ[dense] = position.z;
+}
+
+glm::vec3 Scene::position(SceneHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	return densePosition(dense);
+}
+
+void Scene::setRadius(SceneHandle handle, float radius)
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	m_radius[dense] = radius;
+}
+
+float Scene::radius(SceneHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	return m_radius[dense];
+}
+
+void Scene::setMaterial(SceneHandle handle, uint32_t materialId)
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	m_materialId[dense] = materialId;
+}
+
+uint32_t Scene::material(SceneHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	return m_materialId[dense];
+}
+
+void Scene::setMaterialInstance(SceneHandle handle, uint32_t materialInstance)
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	m_materialInstance[dense] = materialInstance;
+}
+
+uint32_t Scene::materialInstance(SceneHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	return m_materialInstance[dense];
+}
+
+void Scene::setEnabled(SceneHandle handle, bool enabled)
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	if (enabled)
+		m_flags[dense] |= Enabled;
+	else
+		m_flags[dense] &= ~Enabled;
+}
+
+bool Scene::isEnabled(SceneHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	return (m_flags[dense] & Enabled) != 0;
+}
+
+uint8_t Scene::lod(SceneHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	return m_lod[dense];
+}
+
+void Scene::cull(const glm::mat4& viewProjection)
+{
+	// Extract the six frustum planes (Gribb & Hartmann), normalized so that
+	// the plane equation gives a distance that can be compared to a radius.
+	float planes[6][4];
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			planes[i * 2][c] = viewProjection[c][3] + viewProjection[c][i];
+			planes[i * 2 + 1][c] = viewProjection[c][3] - viewProjection[c][i];
+		}
+	}
+	for (auto& plane : planes)
+	{
+		const float length = glm::length(glm::vec3(plane[0], plane[1], plane[2]));
+		if (length > 0.0f)
+			for (float& value : plane)
+				value /= length;
+	}
+
+	const float* px = m_positionX.data();
+	const float* py = m_positionY.data();
+	const float* pz = m_positionZ.data();
+	const float* radius = m_radius.data();
+	uint8_t* flags = m_flags.data();
+	const size_t count = m_radius.size();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		bool inside = true;
+		for (const auto& plane : planes)
+			inside &= plane[0] * px[i] + plane[1] * py[i] + plane[2] * pz[i] + plane[3] >= -radius[i];
+
+		const uint8_t visible = (inside && (flags[i] & Enabled)) ? Visible : 0;
+		flags[i] = static_cast<uint8_t>((flags[i] & ~Visible) | visible);
+	}
+}
+
+void Scene::updateLods(const glm::vec3& viewPosition)
+{
+	const float* px = m_positionX.data();
+	const float* py = m_positionY.data();
+	const float* pz = m_positionZ.data();
+	const float* radius = m_radius.data();
+	uint8_t* lod = m_lod.data();
+	const size_t count = m_radius.size();
+
+	// Compare squared distances against squared thresholds scaled by the radius
+	// to avoid a square root and a division per instance.
+	const float* distances = m_lodDistances.data();
+	const size_t lodDistanceCount = m_lodDistances.size();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float dx = px[i] - viewPosition.x;
+		const float dy = py[i] - viewPosition.y;
+		const float dz = pz[i] - viewPosition.z;
+		const float distanceSquared = dx * dx + dy * dy + dz * dz;
+		const float radiusSquared = radius[i] * radius[i];
+
+		uint8_t level = 0;
+		for (size_t l = 0; l < lodDistanceCount; ++l)
+			level += distanceSquared > distances[l] * distances[l] * radiusSquared ? 1 : 0;
+		lod[i] = level;
+	}
+}
+
+const std::vector<uint32_t>& Scene::buildDrawList()
+{
+	const uint8_t* flags = m_flags.data();
+	const uint32_t count = static_cast<uint32_t>(m_radius.size());
+
+	// The RenderQueue orders the draws, the list keeps the scene order
+	m_drawList.clear();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (flags[i] & Visible)
+			m_drawList.push_back(i);
+	}
+
+	return m_drawList;
+}
+
+void Scene::setLodDistances(const std::vector<float>& distances)
+{
+	assert(distances.size() < 255);
+	m_lodDistances = distances;
+	std::sort(m_lodDistances.begin(), m_lodDistances.end());
+}
+
+SceneHandle Scene::denseHandle(uint32_t index) const
+{
+	SceneHandle handle;
+	handle.slot = m_denseToSlot[index];
+	handle.generation = m_slotGeneration[handle.slot];
+	return handle;
+}
+
+uint32_t Scene::denseIndex(SceneHandle handle) const
+{
+	if (handle.slot >= m_slotGeneration.size() || m_slotGeneration[handle.slot] != handle.generation)
+		return InvalidIndex;
+	return m_slotToDense[handle.slot];
+}
@@ -0,0 +1,114 @@
+#pragma once
+#ifndef SCENE_H
+#define SCENE_H
+
+/**
+ * @file Scene.h
+ *
+ * @brief Data-oriented container of sphere instances.
+ *
+ * Every attribute of the instances is stored in its own contiguous array
+ * (structure of arrays) so that the per-frame passes (culling, level of
+ * detail selection, draw list building) are linear walks over packed memory.
+ * Instances are referred to by generational handles that stay valid while
+ * the dense arrays are compacted.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct SceneHandle {
+	uint32_t slot = ~0u;
+	uint32_t generation = 0;
+
+	inline bool operator==(const SceneHandle& other) const { return slot == other.slot && generation == other.generation; }
+	inline bool operator!=(const SceneHandle& other) const { return !(*this == other); }
+};
+
+class Scene {
+public:
+	enum Flags : uint8_t {
+		Enabled = 1 << 0, // Instance is allowed to be drawn (set by the user)
+		Visible = 1 << 1, // Instance passed the last culling pass
+	};
+
+	Scene();
+
+	void reserve(size_t count);
+	void clear();
+
+	SceneHandle create(const glm::vec3& position, float radius, uint32_t materialId, uint32_t materialInstance = 0);
+	bool destroy(SceneHandle handle);
+	bool isValid(SceneHandle handle) const;
+
+	inline size_t size() const { return m_radius.size(); }
+
+	// Accessors through handles
+	void setPosition(SceneHandle handle, const glm::vec3& position);
+	glm::vec3 position(SceneHandle handle) const;
+	void setRadius(SceneHandle handle, float radius);
+	float radius(SceneHandle handle) const;
+	void setMaterial(SceneHandle handle, uint32_t materialId);
+	uint32_t material(SceneHandle handle) const;
+	// Index in the MaterialTable, the parameters of the material
+	void setMaterialInstance(SceneHandle handle, uint32_t materialInstance);
+	uint32_t materialInstance(SceneHandle handle) const;
+	void setEnabled(SceneHandle handle, bool enabled);
+	bool isEnabled(SceneHandle handle) const;
+	uint8_t lod(SceneHandle handle) const;
+
+	// Per-frame passes
+	void cull(const glm::mat4& viewProjection);
+	void updateLods(const glm::vec3& viewPosition);
+	const std::vector<uint32_t>& buildDrawList();
+
+	// Distance (expressed in radii) after which each level of detail starts.
+	// Level 0 is the most detailed one.
+	void setLodDistances(const std::vector<float>& distances);
+	inline size_t lodCount() const { return m_lodDistances.size() + 1; }
+
+	// Dense accessors, used when walking a draw list
+	inline glm::vec3 densePosition(uint32_t index) const { return glm::vec3(m_positionX[index], m_positionY[index], m_positionZ[index]); }
+	inline float denseRadius(uint32_t index) const { return m_radius[index]; }
+	inline uint32_t denseMaterial(uint32_t index) const { return m_materialId[index]; }
+	inline uint32_t denseMaterialInstance(uint32_t index) const { return m_materialInstance[index]; }
+	inline uint8_t denseLod(uint32_t index) const { return m_lod[index]; }
+	inline uint8_t denseFlags(uint32_t index) const { return m_flags[index]; }
+	SceneHandle denseHandle(uint32_t index) const;
+
+	inline const float* positionsX() const { return m_positionX.data(); }
+	inline const float* positionsY() const { return m_positionY.data(); }
+	inline const float* positionsZ() const { return m_positionZ.data(); }
+	inline const float* radii() const { return m_radius.data(); }
+
+private:
+	uint32_t denseIndex(SceneHandle handle) const;
+
+	// Dense instance data (structure of arrays)
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	std::vector<float> m_radius;
+	std::vector<uint32_t> m_materialId;
+	std::vector<uint32_t> m_materialInstance;
+	std::vector<uint8_t> m_lod;
+	std::vector<uint8_t> m_flags;
+	std::vector<uint32_t> m_denseToSlot;
+
+	// Handle indirection: slot -> dense index (or next free slot when unused)
+	std::vector<uint32_t> m_slotToDense;
+	std::vector<uint32_t> m_slotGeneration;
+	uint32_t m_freeSlot = ~0u;
+
+	std::vector<float> m_lodDistances;
+
+	// Draw list (dense indices of the visible instances, in dense order)
+	std::vector<uint32_t> m_drawList;
+};
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+#ifndef SHADERPORTS_H
+#define SHADERPORTS_H
+
+/**
+ * @file ShaderPorts.h
+ *
+ * @brief C++ versions of the fragment shaders, shared by the CPU renderers.
+ *
+ * Keep in sync with basicShader.frag and litShader.frag.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+enum class ShadingModel { Lit, Unlit, Wireframe };
+
+// Uniforms of the materials (see BasicMaterial and LitMaterial)
+struct ShadingParameters {
+	ShadingModel shading = ShadingModel::Lit;
+	glm::vec3 color = glm::vec3(1.0f);
+	glm::vec3 ambiant = glm::vec3(0.0f);
+	glm::vec3 diffuse = glm::vec3(1.0f);
+	glm::vec3 specular = glm::vec3(1.0f);
+	float specularExponent = 0.0f;
+	glm::vec3 lightPosition = glm::vec3(1.0f);
+	glm::vec4 lightColor = glm::vec4(1.0f);
+	bool phong = true;
+};
+
+// basicShader.frag
+inline glm::vec4 basicShader(const ShadingParameters& uniforms)
+{
+	return glm::vec4(uniforms.color, 1.0f);
+}
+
+// litShader.frag
+inline glm::vec4 litShader(const ShadingParameters& uniforms, const glm::vec3& fNormal, const glm::vec3& fEyeVector, const glm::vec3& fPosition)
+{
+	const glm::vec3 lightPosition = uniforms.lightPosition;
+
+	const glm::vec3 lightDirection = glm::normalize(lightPosition - fPosition);
+	const glm::vec3 nfNormal = glm::normalize(fNormal);
+
+	const glm::vec3 nfEyeVector = glm::normalize(fEyeVector);
+
+	const float diffuse = std::max(0.0f, glm::dot(nfNormal, lightDirection));
+	float specular = 0.0f;
+
+	if (diffuse > 0.0f && uniforms.specularExponent > 0.0f) {
+		if (uniforms.phong)
+		{
+			const glm::vec3 reflectedVector = glm::reflect(-lightDirection, nfNormal);
+			specular = std::pow(std::max(0.0f, glm::dot(nfEyeVector, reflectedVector)), uniforms.specularExponent);
+		}
+		else
+		{
+			const glm::vec3 halfwayDir = glm::normalize(lightDirection + nfEyeVector);
+			specular = std::pow(std::max(glm::dot(nfNormal, halfwayDir), 0.0f), uniforms.specularExponent);
+		}
+	}
+
+	const glm::vec4 ambiantContribution = glm::vec4(uniforms.ambiant, 1.0f);
+	const glm::vec4 diffuseContribution = glm::vec4(uniforms.diffuse, 1.0f) * diffuse;
+	const glm::vec4 specularContribution = glm::vec4(uniforms.specular, 1.0f) * specular;
+
+	const glm::vec3 lightOffset = fPosition - lightPosition;
+	return ambiantContribution + uniforms.lightColor * (diffuseContribution + specularContribution) * (1.0f / glm::dot(lightOffset, lightOffset));
+}
+
+// Color as written to an RGBA8 framebuffer (r in the lowest byte)
+inline uint32_t packColor(const glm::vec4& color)
+{
+	const glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+	return static_cast<uint32_t>(c.r) | (static_cast<uint32_t>(c.g) << 8) | (static_cast<uint32_t>(c.b) << 16) | (static_cast<uint32_t>(c.a) << 24);
+}
+#endif
@@ -18,8 +18,44 @@
   */
 
 #include "ShaderProgram.h"
+#include "GLState.h"
+#include "ProgramCache.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
+namespace
+{
+	// Bytes of a value of a uniform type, 0 for the ones the setters do not write
+	uint32_t uniformTypeBytes(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_FLOAT:
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+			return 4;
+		case GL_FLOAT_VEC2:
+			return 8;
+		case GL_FLOAT_VEC3:
+			return 12;
+		case GL_FLOAT_VEC4:
+			return 16;
+		case GL_FLOAT_MAT3:
+			return 36;
+		case GL_FLOAT_MAT4:
+			return 64;
+		default:
+			return 0;
+		}
+	}
+}
+
+
 // utility function for checking shader compilation/linking errors.
 // ------------------------------------------------------------------------
 bool checkCompileErrors(GLuint shader, std::string type)
@@ -52,10 +88,11 @@ bool checkCompileErrors(GLuint shader, std::string type)
 ShaderProgram::ShaderProgram()
 {
 	// Note that the Glad need to be initialized before calling this line
-	m_ID = glCreateProgram();
+	m_program = GpuHandle::create(GpuResourceType::Program, "ShaderProgram", "program");
 }
 
-bool ShaderProgram::addShaderFromSource(GLenum shader_type, const std::string& path) {
+bool ShaderProgram::addShaderFromSource(GLenum shader_type, const std::string& path, const std::string& defines) {
+	PROFILE_ZONE("ShaderProgram::addShaderFromSource");
 	std::string shader_type_str = [&]() -> std::string {
 		if (shader_type == GL_VERTEX_SHADER) {
 			return "VERTEX";
@@ -102,20 +139,282 @@ bool ShaderProgram::addShaderFromSource(GLenum shader_type, const std::string& p
 		std::cerr << e.what() << std::endl;
 		return false;
 	}
-	GLuint shader_id = glCreateShader(shader_type);
-	const char* code_c_str = code.c_str();
+	if (!defines.empty()) {
+		// #version must stay the first line
+		size_t position = 0;
+		const size_t version = code.find("#version");
+		if (version != std::string::npos) {
+			const size_t end = code.find('\n', version);
+			position = end == std::string::npos ? code.size() : end + 1;
+			if (end == std::string::npos)
+				code += '\n';
+		}
+		code.insert(position, defines);
+	}
+
+	// Compiled by link(), unless the program is in the cache
+	m_sources.push_back({ shader_type, shader_type_str, code });
+	return true;
+}
+
+bool ShaderProgram::hasParallelCompile() {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i)
+	{
+		const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+		if (name && (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+			return true;
+	}
+	return false;
+}
+
+void ShaderProgram::compileShader(const Source& source) {
+	PROFILE_ZONE("ShaderProgram::compileShader");
+	GpuHandle shader = GpuHandle::createShader(source.type, "ShaderProgram");
+	GLuint shader_id = shader.id();
+	const char* code_c_str = source.code.c_str();
 	glShaderSource(shader_id, 1, &code_c_str, NULL);
 	glCompileShader(shader_id);
-	bool success = checkCompileErrors(shader_id, shader_type_str);
-	glAttachShader(m_ID, shader_id);
-	if (success) {
-		m_shaders_ids[shader_type_str] = shader_id;
-	}
-	return success;
+	glAttachShader(m_program.id(), shader_id);
+	m_shaders_ids[source.typeName] = std::move(shader);
 }
 
 bool ShaderProgram::link() {
-	glLinkProgram(m_ID);
-	m_linked = checkCompileErrors(m_ID, "PROGRAM");
+	return beginLink() && finishLink();
+}
+
+bool ShaderProgram::beginLink() {
+	PROFILE_ZONE("ShaderProgram::beginLink");
+	m_linked = false;
+	m_linkPending = true;
+	ProgramCache& cache = ProgramCache::instance();
+	m_cached = cache.enabled();
+	m_loaded = false;
+	if (m_cached) {
+		std::string sources;
+		for (const Source& source : m_sources)
+			sources += source.typeName + "\n" + source.code + "\n";
+		m_cacheKey = cache.key(sources);
+		if (cache.load(m_program.id(), m_cacheKey)) {
+			m_sources.clear();
+			m_loaded = true;
+			return true;
+		}
+		glProgramParameteri(m_program.id(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	// Asking for the compile status would wait for the compiler, it is
+	// only done by finishLink()
+	m_pollable = hasParallelCompile();
+	for (const Source& source : m_sources)
+		compileShader(source);
+	m_sources.clear();
+	glLinkProgram(m_program.id());
+	return true;
+}
+
+bool ShaderProgram::isLinkDone() const {
+	if (!m_linkPending || m_loaded || !m_pollable)
+		return true;
+	GLint done = GL_FALSE;
+	glGetProgramiv(m_program.id(), GL_COMPLETION_STATUS_KHR, &done);
+	return done == GL_TRUE;
+}
+
+bool ShaderProgram::finishLink() {
+	if (!m_linkPending)
+		return m_linked;
+	PROFILE_ZONE("ShaderProgram::finishLink");
+	m_linkPending = false;
+	if (m_loaded) {
+		m_linked = readUniforms();
+		return m_linked;
+	}
+
+	bool compiled = true;
+	for (const auto& shader : m_shaders_ids)
+		compiled &= checkCompileErrors(shader.second.id(), shader.first);
+	if (!compiled)
+		return false;
+
+	m_linked = checkCompileErrors(m_program.id(), "PROGRAM");
+	if (m_linked)
+		m_linked = readUniforms();
+	if (m_linked && m_cached)
+		ProgramCache::instance().store(m_program.id(), m_cacheKey);
 	return m_linked;
 }
+
+bool ShaderProgram::bindUniformBlock(const char* name, GLuint binding) {
+	const GLuint index = glGetUniformBlockIndex(m_program.id(), name);
+	if (index == GL_INVALID_INDEX) {
+		std::cerr << "Unable to find the uniform block " << name << std::endl;
+		return false;
+	}
+	glUniformBlockBinding(m_program.id(), index, binding);
+	return true;
+}
+
+bool ShaderProgram::bindStorageBlock(const char* name, GLuint binding) {
+	const GLuint index = glGetProgramResourceIndex(m_program.id(), GL_SHADER_STORAGE_BLOCK, name);
+	if (index == GL_INVALID_INDEX) {
+		std::cerr << "Unable to find the storage block " << name << std::endl;
+		return false;
+	}
+	glShaderStorageBlockBinding(m_program.id(), index, binding);
+	return true;
+}
+
+void ShaderProgram::bind() {
+	if (!m_linked) {
+		// Warn user
+		std::cerr << "Shader is not properly linked!\n";
+	}
+	GLState::useProgram(m_program.id());
+
+	if (m_dirtyCount > 0) {
+		for (Uniform& uniform : m_uniforms)
+		{
+			if (uniform.dirty)
+				upload(uniform);
+		}
+		m_dirtyCount = 0;
+	}
+}
+
+int ShaderProgram::uniformLocation(UniformName name) const
+{
+	auto uniform = std::lower_bound(m_uniforms.begin(), m_uniforms.end(), name.value(),
+		[](const Uniform& left, uint32_t hash) { return left.hash < hash; });
+	return uniform != m_uniforms.end() && uniform->hash == name.value() ? uniform->location : -1;
+}
+
+ShaderProgram::Uniform* ShaderProgram::findUniform(uint32_t hash)
+{
+	auto uniform = std::lower_bound(m_uniforms.begin(), m_uniforms.end(), hash,
+		[](const Uniform& left, uint32_t value) { return left.hash < value; });
+	return uniform != m_uniforms.end() && uniform->hash == hash ? &*uniform : nullptr;
+}
+
+void ShaderProgram::setValue(UniformName name, const void* value, size_t bytes) {
+	Uniform* uniform = findUniform(name.value());
+	if (!uniform || bytes != uniform->bytes) {
+		if (uniform)
+			std::cerr << "Uniform " << name.name() << " set with a value of the wrong type" << std::endl;
+		return;
+	}
+
+	setValue(*uniform, value);
+}
+
+void ShaderProgram::setValue(Uniform& uniform, const void* value) {
+	uint8_t* shadow = m_values.data() + uniform.offset;
+	if (std::memcmp(shadow, value, uniform.bytes) == 0) {
+		++RenderStats::current().uniformSkips;
+		return;
+	}
+	std::memcpy(shadow, value, uniform.bytes);
+
+	if (GLState::currentProgram() == m_program.id()) {
+		upload(uniform);
+	}
+	else if (!uniform.dirty) {
+		uniform.dirty = true;
+		++m_dirtyCount;
+	}
+}
+
+void ShaderProgram::copyUniformValues(const ShaderProgram& other) {
+	for (const Uniform& source : other.m_uniforms)
+	{
+		Uniform* uniform = findUniform(source.hash);
+		if (uniform && uniform->type == source.type && uniform->bytes > 0)
+			setValue(*uniform, other.m_values.data() + source.offset);
+	}
+}
+
+void ShaderProgram::upload(Uniform& uniform) {
+	const void* value = m_values.data() + uniform.offset;
+	switch (uniform.type)
+	{
+	case GL_FLOAT:
+		glUniform1fv(uniform.location, 1, static_cast<const GLfloat*>(value));
+		break;
+	case GL_FLOAT_VEC2:
+		glUniform2fv(uniform.location, 1, static_cast<const GLfloat*>(value));
+		break;
+	case GL_FLOAT_VEC3:
+		glUniform3fv(uniform.location, 1, static_cast<const GLfloat*>(value));
+		break;
+	case GL_FLOAT_VEC4:
+		glUniform4fv(uniform.location, 1, static_cast<const GLfloat*>(value));
+		break;
+	case GL_FLOAT_MAT3:
+		glUniformMatrix3fv(uniform.location, 1, GL_FALSE, static_cast<const GLfloat*>(value));
+		break;
+	case GL_FLOAT_MAT4:
+		glUniformMatrix4fv(uniform.location, 1, GL_FALSE, static_cast<const GLfloat*>(value));
+		break;
+	default:
+		glUniform1iv(uniform.location, 1, static_cast<const GLint*>(value));
+		break;
+	}
+	uniform.dirty = false;
+	++RenderStats::current().uniformUploads;
+}
+
+bool ShaderProgram::readUniforms() {
+	m_uniforms.clear();
+	m_values.clear();
+	m_dirtyCount = 0;
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(m_program.id(), GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(m_program.id(), GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<std::string> names;
+	std::vector<GLchar> buffer(std::max(maxLength, 1));
+	for (GLint i = 0; i < count; ++i)
+	{
+		GLsizei length = 0;
+		Uniform uniform;
+		glGetActiveUniform(m_program.id(), static_cast<GLuint>(i), maxLength, &length, &uniform.size, &uniform.type, buffer.data());
+		std::string name(buffer.data(), length);
+		// Members of uniform blocks have no location
+		uniform.location = glGetUniformLocation(m_program.id(), name.c_str());
+		if (uniform.location < 0)
+			continue;
+
+		// Arrays are named after their first element, "lights[0]"
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+			name.resize(name.size() - 3);
+		uniform.hash = UniformName::hash(name.c_str());
+		uniform.offset = static_cast<uint32_t>(m_values.size());
+		uniform.bytes = uniformTypeBytes(uniform.type);
+		uniform.dirty = false;
+
+		// Start from the values of the program, 0 unless the shader initializes them
+		m_values.resize(m_values.size() + uniform.bytes);
+		if (uniform.type == GL_FLOAT || uniform.type == GL_FLOAT_VEC2 || uniform.type == GL_FLOAT_VEC3 || uniform.type == GL_FLOAT_VEC4
+			|| uniform.type == GL_FLOAT_MAT3 || uniform.type == GL_FLOAT_MAT4)
+			glGetUniformfv(m_program.id(), uniform.location, reinterpret_cast<GLfloat*>(m_values.data() + uniform.offset));
+		else if (uniform.bytes > 0)
+			glGetUniformiv(m_program.id(), uniform.location, reinterpret_cast<GLint*>(m_values.data() + uniform.offset));
+		m_uniforms.push_back(uniform);
+		names.push_back(name);
+	}
+
+	for (size_t i = 0; i < m_uniforms.size(); ++i)
+	{
+		for (size_t j = i + 1; j < m_uniforms.size(); ++j)
+		{
+			if (m_uniforms[i].hash == m_uniforms[j].hash) {
+				std::cerr << "Uniforms " << names[i] << " and " << names[j] << " have the same hash, rename one of them" << std::endl;
+				return false;
+			}
+		}
+	}
+	std::sort(m_uniforms.begin(), m_uniforms.end(), [](const Uniform& left, const Uniform& right) { return left.hash < right.hash; });
+	return true;
+}
@@ -15,8 +15,18 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+// GL_KHR_parallel_shader_compile, not in the glad loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#include "GpuResources.h"
+#include "RenderStats.h"
+
+#include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -50,6 +60,31 @@ inline void CheckOpenGLError(const char* stmt, const char* fname, int line)
 #define GL_CHECK(stmt) stmt
 #endif
 
+// Name of a uniform with its FNV-1a hash. Declared constexpr from a string
+// literal, the hash is computed at compile time:
+//
+// static constexpr UniformName modelUniform = "model";
+class UniformName
+{
+public:
+    constexpr UniformName(const char* name) : m_name(name), m_hash(hash(name)) {}
+
+    inline constexpr const char* name() const { return m_name; }
+    inline constexpr uint32_t value() const { return m_hash; }
+
+    static constexpr uint32_t hash(const char* name)
+    {
+        uint32_t value = 2166136261u;
+        for (; *name != '\0'; ++name)
+            value = (value ^ static_cast<uint8_t>(*name)) * 16777619u;
+        return value;
+    }
+
+private:
+    const char* m_name;
+    uint32_t m_hash;
+};
+
 // Helper object that simplify the shader loading and interactions
 // Can be extended if necessary
 class ShaderProgram
@@ -60,63 +95,139 @@ public:
    ShaderProgram();
    
    // ------------------------------------------------------------------------
-   // attach shader from sources 
+   // read a shader source, compiled by link(). The defines ("#define X\n"
+   // lines) are inserted after the #version line
    // return true if sucessfull
-   bool addShaderFromSource(GLenum type, const std::string& path);
+   bool addShaderFromSource(GLenum type, const std::string& path, const std::string& defines = "");
    
    // ------------------------------------------------------------------------
-   // link the different shaders to make a full program 
+   // load the program from the ProgramCache, or compile the shaders and link
+   // them to make a full program (then saved in the cache), and read the
+   // locations of its active uniforms
    // return true if sucessfull
    bool link();
 
+   // ------------------------------------------------------------------------
+   // link() in two steps, so that the driver compiles several programs at the
+   // same time: beginLink() submits the shaders and the link without waiting,
+   // finishLink() waits for them and checks the result. isLinkDone() tells
+   // whether finishLink() would wait, with GL_KHR_parallel_shader_compile
+   // (always true without it, finishLink() then waits)
+   bool beginLink();
+   bool isLinkDone() const;
+   bool finishLink();
+
    // ------------------------------------------------------------------------
    // get program ID to interact directly with the shader program
-   inline GLuint programId() const { return m_ID; }
+   inline GLuint programId() const { return m_program.id(); }
 
    // ------------------------------------------------------------------------
-   // use shader program
-   inline void bind() const { 
-       if(!m_linked) {
-           // Warn user
-           std::cerr << "Shader is not properly linked!\n";
-       }
-       glUseProgram(m_ID); 
-   }
+   // use shader program, uploads the uniforms set while it was not bound
+   void bind();
    
 
    // get id value corresponding to attribute
     // ------------------------------------------------------------------------
-   inline int attributeLocation(const char* name) const { return glGetAttribLocation(m_ID, name); }
-   inline int attributeLocation(const std::string name) const { return glGetAttribLocation(m_ID, name.c_str()); }
+   inline int attributeLocation(const char* name) const { return glGetAttribLocation(m_program.id(), name); }
+   inline int attributeLocation(const std::string name) const { return glGetAttribLocation(m_program.id(), name.c_str()); }
+
+    // attach a uniform block of the program to a binding point
+    // return true if sucessfull
+    // ------------------------------------------------------------------------
+    bool bindUniformBlock(const char* name, GLuint binding);
+
+    // attach a shader storage block of the program to a binding point
+    // return true if sucessfull
+    // ------------------------------------------------------------------------
+    bool bindStorageBlock(const char* name, GLuint binding);
+
+    // location of an active uniform, from the table read by link(), -1 when
+    // the program does not use it (the setters then do nothing, like OpenGL)
+    // ------------------------------------------------------------------------
+    int uniformLocation(UniformName name) const;
 
-    // utility uniform functions
+    // take the values of the uniforms of another program that this one also
+    // has (same name and type)
     // ------------------------------------------------------------------------
-    inline void setBool(const std::string& name, bool value) const { glUniform1i(glGetUniformLocation(m_ID, name.c_str()), (int)value); }
+    void copyUniformValues(const ShaderProgram& other);
 
+    // utility uniform functions. The values are compared to a copy of the
+    // ones of the program, setting the same value again costs no OpenGL call.
+    // When the program is not bound, the new values wait for bind().
     // ------------------------------------------------------------------------
-    inline void setInt(const std::string& name, int value) const { glUniform1i(glGetUniformLocation(m_ID, name.c_str()), value); }
+    inline void setBool(UniformName name, bool value) { const GLint integer = value; setValue(name, &integer, sizeof(integer)); }
 
     // ------------------------------------------------------------------------
-    inline void setFloat(const std::string& name, float value) const { glUniform1f(glGetUniformLocation(m_ID, name.c_str()), value); }
+    inline void setInt(UniformName name, int value) { const GLint integer = value; setValue(name, &integer, sizeof(integer)); }
 
     // ------------------------------------------------------------------------
-    inline void setMat4(const std::string& name, const glm::mat4& mat) const { glUniformMatrix4fv(glGetUniformLocation(m_ID, name.c_str()), 1, GL_FALSE, &mat[0][0]); }
+    inline void setFloat(UniformName name, float value) { setValue(name, &value, sizeof(value)); }
 
     // ------------------------------------------------------------------------
-    inline void setMat3(const std::string& name, const glm::mat3& mat) const { glUniformMatrix3fv(glGetUniformLocation(m_ID, name.c_str()), 1, GL_FALSE, &mat[0][0]); }
+    inline void setMat4(UniformName name, const glm::mat4& mat) { setValue(name, &mat[0][0], sizeof(mat)); }
 
     // ------------------------------------------------------------------------
-    inline void setVec4(const std::string& name, const glm::vec4& value) const { glUniform4fv(glGetUniformLocation(m_ID, name.c_str()), 1, &value[0]); }
+    inline void setMat3(UniformName name, const glm::mat3& mat) { setValue(name, &mat[0][0], sizeof(mat)); }
 
     // ------------------------------------------------------------------------
-    inline void setVec3(const std::string& name, const glm::vec3& value) const { glUniform3fv(glGetUniformLocation(m_ID, name.c_str()), 1, &value[0]); }
+    inline void setVec4(UniformName name, const glm::vec4& value) { setValue(name, &value[0], sizeof(value)); }
+
+    // ------------------------------------------------------------------------
+    inline void setVec3(UniformName name, const glm::vec3& value) { setValue(name, &value[0], sizeof(value)); }
 
 private:
+    // Active uniform of the linked program, sorted by hash
+    struct Uniform {
+        uint32_t hash;
+        GLint location;
+        GLenum type;
+        GLint size;
+        uint32_t offset; // Of its value in m_values
+        uint32_t bytes;  // Of the first element, the setters do not write arrays
+        bool dirty;      // Value not uploaded yet
+    };
+
+    // Shader read by addShaderFromSource
+    struct Source {
+        GLenum type;
+        std::string typeName;
+        std::string code;
+    };
+
+    // Submit and attach a shader, its status is checked by finishLink()
+    void compileShader(const Source& source);
+
+    // Whether the driver can tell when a compile is done without waiting for it
+    static bool hasParallelCompile();
+
+    // Fill m_uniforms with glGetActiveUniform and m_values with the
+    // values of the program after the link.
+    // return false when two names have the same hash
+    bool readUniforms();
+
+    Uniform* findUniform(uint32_t hash);
+    void setValue(UniformName name, const void* value, size_t bytes);
+    void setValue(Uniform& uniform, const void* value);
+    void upload(Uniform& uniform);
+
     // Shader program id
-    GLuint m_ID;
+    GpuHandle m_program;
     // Does the shader is link?
     bool m_linked = false;
     // List of the different shaders (can be reused if necessary)
-    std::map<std::string, GLuint> m_shaders_ids;
+    std::map<std::string, GpuHandle> m_shaders_ids;
+    // Sources waiting for link()
+    std::vector<Source> m_sources;
+    // State between beginLink() and finishLink()
+    bool m_linkPending = false;
+    bool m_pollable = false; // GL_COMPLETION_STATUS_KHR can be asked
+    bool m_cached = false;   // The ProgramCache is enabled
+    bool m_loaded = false;   // Loaded from the ProgramCache
+    uint64_t m_cacheKey = 0;
+    // Uniform table of the program, never changes after link()
+    std::vector<Uniform> m_uniforms;
+    // Values of the uniforms as the program has them (or will at bind())
+    std::vector<uint8_t> m_values;
+    size_t m_dirtyCount = 0;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,195 @@
+#pragma once
+#ifndef SIMD_H
+#define SIMD_H
+
+/**
+ * @file Simd.h
+ *
+ * @brief Minimal 8-wide float vector used by the CPU side algorithms.
+ *
+ * Maps to one AVX register when the compiler targets AVX, to two SSE
+ * registers on other x86 targets and to plain arrays elsewhere, so the
+ * algorithms are written once for 8 lanes. Define SIMD_FORCE_SCALAR to
+ * compile the plain version on any target.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <cmath>
+
+#if defined(SIMD_FORCE_SCALAR)
+#define SIMD_SCALAR 1
+#elif defined(__AVX__)
+#define SIMD_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE 1
+#include <emmintrin.h>
+#else
+#define SIMD_SCALAR 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Name of the instruction set used by SimdFloat
+inline const char* simdPathName()
+{
+#if defined(SIMD_AVX)
+	return "AVX";
+#elif defined(SIMD_SSE)
+	return "SSE";
+#else
+	return "Scalar";
+#endif
+}
+
+// Index of the lowest bit set, used to iterate over the lanes of a mask
+inline int lowestLane(int bits)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, static_cast<unsigned long>(bits));
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(static_cast<unsigned int>(bits));
+#endif
+}
+
+struct SimdMask;
+
+struct SimdFloat {
+	static constexpr int Width = 8;
+
+#if defined(SIMD_AVX)
+	__m256 v;
+
+	SimdFloat() = default;
+	inline explicit SimdFloat(__m256 value) : v(value) {}
+	inline SimdFloat(float value) : v(_mm256_set1_ps(value)) {}
+
+	static inline SimdFloat load(const float* data) { return SimdFloat(_mm256_loadu_ps(data)); }
+	inline void store(float* data) const { _mm256_storeu_ps(data, v); }
+	// 0, 1, 2, ... 7
+	static inline SimdFloat lanes() { return SimdFloat(_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)); }
+
+	inline SimdFloat operator+(const SimdFloat& o) const { return SimdFloat(_mm256_add_ps(v, o.v)); }
+	inline SimdFloat operator-(const SimdFloat& o) const { return SimdFloat(_mm256_sub_ps(v, o.v)); }
+	inline SimdFloat operator*(const SimdFloat& o) const { return SimdFloat(_mm256_mul_ps(v, o.v)); }
+	inline SimdFloat operator/(const SimdFloat& o) const { return SimdFloat(_mm256_div_ps(v, o.v)); }
+#elif defined(SIMD_SSE)
+	__m128 lo, hi;
+
+	SimdFloat() = default;
+	inline SimdFloat(__m128 low, __m128 high) : lo(low), hi(high) {}
+	inline SimdFloat(float value) : lo(_mm_set1_ps(value)), hi(_mm_set1_ps(value)) {}
+
+	static inline SimdFloat load(const float* data) { return SimdFloat(_mm_loadu_ps(data), _mm_loadu_ps(data + 4)); }
+	inline void store(float* data) const { _mm_storeu_ps(data, lo); _mm_storeu_ps(data + 4, hi); }
+	static inline SimdFloat lanes() { return SimdFloat(_mm_setr_ps(0, 1, 2, 3), _mm_setr_ps(4, 5, 6, 7)); }
+
+	inline SimdFloat operator+(const SimdFloat& o) const { return SimdFloat(_mm_add_ps(lo, o.lo), _mm_add_ps(hi, o.hi)); }
+	inline SimdFloat operator-(const SimdFloat& o) const { return SimdFloat(_mm_sub_ps(lo, o.lo), _mm_sub_ps(hi, o.hi)); }
+	inline SimdFloat operator*(const SimdFloat& o) const { return SimdFloat(_mm_mul_ps(lo, o.lo), _mm_mul_ps(hi, o.hi)); }
+	inline SimdFloat operator/(const SimdFloat& o) const { return SimdFloat(_mm_div_ps(lo, o.lo), _mm_div_ps(hi, o.hi)); }
+#else
+	float v[Width];
+
+	SimdFloat() = default;
+	inline SimdFloat(float value) { for (int i = 0; i < Width; ++i) v[i] = value; }
+
+	static inline SimdFloat load(const float* data) { SimdFloat r; for (int i = 0; i < Width; ++i) r.v[i] = data[i]; return r; }
+	inline void store(float* data) const { for (int i = 0; i < Width; ++i) data[i] = v[i]; }
+	static inline SimdFloat lanes() { SimdFloat r; for (int i = 0; i < Width; ++i) r.v[i] = float(i); return r; }
+
+	inline SimdFloat operator+(const SimdFloat& o) const { SimdFloat r; for (int i = 0; i < Width; ++i) r.v[i] = v[i] + o.v[i]; return r; }
+	inline SimdFloat operator-(const SimdFloat& o) const { SimdFloat r; for (int i = 0; i < Width; ++i) r.v[i] = v[i] - o.v[i]; return r; }
+	inline SimdFloat operator*(const SimdFloat& o) const { SimdFloat r; for (int i = 0; i < Width; ++i) r.v[i] = v[i] * o.v[i]; return r; }
+	inline SimdFloat operator/(const SimdFloat& o) const { SimdFloat r; for (int i = 0; i < Width; ++i) r.v[i] = v[i] / o.v[i]; return r; }
+#endif
+
+	inline SimdFloat& operator+=(const SimdFloat& o) { return *this = *this + o; }
+	inline SimdFloat& operator-=(const SimdFloat& o) { return *this = *this - o; }
+	inline SimdFloat& operator*=(const SimdFloat& o) { return *this = *this * o; }
+	inline SimdFloat operator-() const { return SimdFloat(0.0f) - *this; }
+
+	inline SimdMask operator<(const SimdFloat& o) const;
+	inline SimdMask operator<=(const SimdFloat& o) const;
+	inline SimdMask operator>(const SimdFloat& o) const;
+	inline SimdMask operator>=(const SimdFloat& o) const;
+};
+
+// Result of a lane-wise comparison
+struct SimdMask {
+#if defined(SIMD_AVX)
+	__m256 v;
+	inline explicit SimdMask(__m256 value) : v(value) {}
+
+	inline SimdMask operator&(const SimdMask& o) const { return SimdMask(_mm256_and_ps(v, o.v)); }
+	inline SimdMask operator|(const SimdMask& o) const { return SimdMask(_mm256_or_ps(v, o.v)); }
+	inline SimdMask andNot(const SimdMask& o) const { return SimdMask(_mm256_andnot_ps(o.v, v)); }
+	// One bit per lane
+	inline int bits() const { return _mm256_movemask_ps(v); }
+#elif defined(SIMD_SSE)
+	__m128 lo, hi;
+	inline SimdMask(__m128 low, __m128 high) : lo(low), hi(high) {}
+
+	inline SimdMask operator&(const SimdMask& o) const { return SimdMask(_mm_and_ps(lo, o.lo), _mm_and_ps(hi, o.hi)); }
+	inline SimdMask operator|(const SimdMask& o) const { return SimdMask(_mm_or_ps(lo, o.lo), _mm_or_ps(hi, o.hi)); }
+	inline SimdMask andNot(const SimdMask& o) const { return SimdMask(_mm_andnot_ps(o.lo, lo), _mm_andnot_ps(o.hi, hi)); }
+	inline int bits() const { return _mm_movemask_ps(lo) | (_mm_movemask_ps(hi) << 4); }
+#else
+	bool v[SimdFloat::Width];
+	SimdMask() = default;
+
+	inline SimdMask operator&(const SimdMask& o) const { SimdMask r; for (int i = 0; i < SimdFloat::Width; ++i) r.v[i] = v[i] && o.v[i]; return r; }
+	inline SimdMask operator|(const SimdMask& o) const { SimdMask r; for (int i = 0; i < SimdFloat::Width; ++i) r.v[i] = v[i] || o.v[i]; return r; }
+	inline SimdMask andNot(const SimdMask& o) const { SimdMask r; for (int i = 0; i < SimdFloat::Width; ++i) r.v[i] = v[i] && !o.v[i]; return r; }
+	inline int bits() const { int r = 0; for (int i = 0; i < SimdFloat::Width; ++i) r |= v[i] ? (1 << i) : 0; return r; }
+#endif
+
+	inline bool any() const { return bits() != 0; }
+	inline bool all() const { return bits() == (1 << SimdFloat::Width) - 1; }
+};
+
+#if defined(SIMD_AVX)
+inline SimdMask SimdFloat::operator<(const SimdFloat& o) const { return SimdMask(_mm256_cmp_ps(v, o.v, _CMP_LT_OQ)); }
+inline SimdMask SimdFloat::operator<=(const SimdFloat& o) const { return SimdMask(_mm256_cmp_ps(v, o.v, _CMP_LE_OQ)); }
+inline SimdMask SimdFloat::operator>(const SimdFloat& o) const { return SimdMask(_mm256_cmp_ps(v, o.v, _CMP_GT_OQ)); }
+inline SimdMask SimdFloat::operator>=(const SimdFloat& o) const { return SimdMask(_mm256_cmp_ps(v, o.v, _CMP_GE_OQ)); }
+
+inline SimdFloat simdMin(const SimdFloat& a, const SimdFloat& b) { return SimdFloat(_mm256_min_ps(a.v, b.v)); }
+inline SimdFloat simdMax(const SimdFloat& a, const SimdFloat& b) { return SimdFloat(_mm256_max_ps(a.v, b.v)); }
+inline SimdFloat simdSqrt(const SimdFloat& a) { return SimdFloat(_mm256_sqrt_ps(a.v)); }
+// mask ? a : b
+inline SimdFloat simdSelect(const SimdMask& mask, const SimdFloat& a, const SimdFloat& b) { return SimdFloat(_mm256_blendv_ps(b.v, a.v, mask.v)); }
+#elif defined(SIMD_SSE)
+inline SimdMask SimdFloat::operator<(const SimdFloat& o) const { return SimdMask(_mm_cmplt_ps(lo, o.lo), _mm_cmplt_ps(hi, o.hi)); }
+inline SimdMask SimdFloat::operator<=(const SimdFloat& o) const { return SimdMask(_mm_cmple_ps(lo, o.lo), _mm_cmple_ps(hi, o.hi)); }
+inline SimdMask SimdFloat::operator>(const SimdFloat& o) const { return SimdMask(_mm_cmpgt_ps(lo, o.lo), _mm_cmpgt_ps(hi, o.hi)); }
+inline SimdMask SimdFloat::operator>=(const SimdFloat& o) const { return SimdMask(_mm_cmpge_ps(lo, o.lo), _mm_cmpge_ps(hi, o.hi)); }
+
+inline SimdFloat simdMin(const SimdFloat& a, const SimdFloat& b) { return SimdFloat(_mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi)); }
+inline SimdFloat simdMax(const SimdFloat& a, const SimdFloat& b) { return SimdFloat(_mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi)); }
+inline SimdFloat simdSqrt(const SimdFloat& a) { return SimdFloat(_mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi)); }
+inline SimdFloat simdSelect(const SimdMask& mask, const SimdFloat& a, const SimdFloat& b)
+{
+	return SimdFloat(_mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo)),
+		_mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi)));
+}
+#else
+inline SimdMask SimdFloat::operator<(const SimdFloat& o) const { SimdMask r; for (int i = 0; i < Width; ++i) r.v[i] = v[i] < o.v[i]; return r; }
+inline SimdMask SimdFloat::operator<=(const SimdFloat& o) const { SimdMask r; for (int i = 0; i < Width; ++i) r.v[i] = v[i] <= o.v[i]; return r; }
+inline SimdMask SimdFloat::operator>(const SimdFloat& o) const { SimdMask r; for (int i = 0; i < Width; ++i) r.v[i] = v[i] > o.v[i]; return r; }
+inline SimdMask SimdFloat::operator>=(const SimdFloat& o) const { SimdMask r; for (int i = 0; i < Width; ++i) r.v[i] = v[i] >= o.v[i]; return r; }
+
+inline SimdFloat simdMin(const SimdFloat& a, const SimdFloat& b) { SimdFloat r; for (int i = 0; i < SimdFloat::Width; ++i) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+inline SimdFloat simdMax(const SimdFloat& a, const SimdFloat& b) { SimdFloat r; for (int i = 0; i < SimdFloat::Width; ++i) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+inline SimdFloat simdSqrt(const SimdFloat& a) { SimdFloat r; for (int i = 0; i < SimdFloat::Width; ++i) r.v[i] = std::sqrt(a.v[i]); return r; }
+inline SimdFloat simdSelect(const SimdMask& mask, const SimdFloat& a, const SimdFloat& b) { SimdFloat r; for (int i = 0; i < SimdFloat::Width; ++i) r.v[i] = mask.v[i] ? a.v[i] : b.v[i]; return r; }
+#endif
+
+#endif
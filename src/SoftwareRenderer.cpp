@@ -0,0 +1,329 @@
+/**
+ * @file SoftwareRenderer.cpp
+ *
+ * @brief CPU rasterizer producing the same images as the OpenGL materials.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "SoftwareRenderer.h"
+#include "Profiler.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Vertices transformed by each job of the vertex stage
+static const size_t VertexChunkSize = 4096;
+
+SoftwareRenderer::SoftwareRenderer(int width, int height, ThreadPool& threadPool) :
+	m_threadPool(threadPool)
+{
+	m_states.emplace_back();
+	resize(width, height);
+}
+
+void SoftwareRenderer::resize(int width, int height)
+{
+	m_width = std::max(1, width);
+	m_height = std::max(1, height);
+	m_tilesX = (m_width + TileSize - 1) / TileSize;
+	m_tilesY = (m_height + TileSize - 1) / TileSize;
+
+	// Padding so that the last 8-wide span of the buffer can be loaded
+	m_color.assign(static_cast<size_t>(m_width) * m_height + SimdFloat::Width, 0);
+	m_depth.assign(static_cast<size_t>(m_width) * m_height + SimdFloat::Width, 1.0f);
+	m_bins.assign(static_cast<size_t>(m_tilesX) * m_tilesY, std::vector<uint32_t>());
+	m_triangles.clear();
+}
+
+void SoftwareRenderer::setParameters(const Parameters& parameters)
+{
+	m_states.push_back(parameters);
+}
+
+void SoftwareRenderer::setCamera(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPosition)
+{
+	m_viewProjection = projection * view;
+	m_viewPosition = viewPosition;
+}
+
+void SoftwareRenderer::clear(const glm::vec4& color)
+{
+	// Anything drawn before is overwritten
+	m_triangles.clear();
+	for (auto& bin : m_bins)
+		bin.clear();
+
+	m_clearPending = true;
+	m_clearColor = packColor(color);
+}
+
+void SoftwareRenderer::draw(const SphereMesh& mesh, const glm::mat4& model)
+{
+	// Vertex stage, port of litShader.vert (basicShader.vert computes the same position)
+	const size_t vertexCount = mesh.vertexCount();
+	m_clipVertices.resize(vertexCount);
+	const glm::mat3 normalMatrix(model);
+	const size_t chunkCount = (vertexCount + VertexChunkSize - 1) / VertexChunkSize;
+	m_threadPool.parallelFor(chunkCount, [&](size_t chunk) {
+		const size_t end = std::min(vertexCount, (chunk + 1) * VertexChunkSize);
+		for (size_t i = chunk * VertexChunkSize; i < end; ++i)
+		{
+			const glm::vec4 vPosition(mesh.vertices[3 * i], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2], 1.0f);
+			const glm::vec3 vNormal(mesh.normals[3 * i], mesh.normals[3 * i + 1], mesh.normals[3 * i + 2]);
+
+			const glm::vec4 worldPosition = model * vPosition;
+			const glm::vec3 fNormal = normalMatrix * vNormal;
+			const glm::vec3 fPosition = glm::vec3(worldPosition);
+			const glm::vec3 ajustedViewPos = m_viewPosition - fPosition;
+			const glm::vec3 fEyeVector = glm::vec3(ajustedViewPos.x, ajustedViewPos.y, -ajustedViewPos.z);
+
+			ClipVertex& out = m_clipVertices[i];
+			out.position = m_viewProjection * glm::vec4(worldPosition.x, worldPosition.y, -worldPosition.z, 1.0f);
+			for (int c = 0; c < 3; ++c)
+			{
+				out.varyings[c] = fNormal[c];
+				out.varyings[3 + c] = fEyeVector[c];
+				out.varyings[6 + c] = fPosition[c];
+			}
+		}
+	});
+
+	const size_t triangleCount = mesh.triangleCount();
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		setupTriangle(m_clipVertices[mesh.indices[3 * t]], m_clipVertices[mesh.indices[3 * t + 1]], m_clipVertices[mesh.indices[3 * t + 2]]);
+	}
+}
+
+void SoftwareRenderer::setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c)
+{
+	const ClipVertex* vertices[3] = { &a, &b, &c };
+
+	// Trivial rejection against each plane of the frustum
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		int outsideLow = 0, outsideHigh = 0;
+		for (const ClipVertex* v : vertices)
+		{
+			outsideLow += v->position[axis] < -v->position.w ? 1 : 0;
+			outsideHigh += v->position[axis] > v->position.w ? 1 : 0;
+		}
+		if (outsideLow == 3 || outsideHigh == 3)
+			return;
+	}
+
+	auto project = [this](const ClipVertex& v) {
+		ScreenVertex s;
+		s.invW = 1.0f / v.position.w;
+		const glm::vec3 ndc = glm::vec3(v.position) * s.invW;
+		s.x = (ndc.x * 0.5f + 0.5f) * m_width;
+		s.y = (0.5f - ndc.y * 0.5f) * m_height;
+		s.z = ndc.z * 0.5f + 0.5f;
+		for (int i = 0; i < VaryingCount; ++i)
+			s.varyings[i] = v.varyings[i] * s.invW;
+		return s;
+	};
+
+	const bool crossesNear = a.position.z < -a.position.w || b.position.z < -b.position.w || c.position.z < -c.position.w;
+	if (!crossesNear)
+	{
+		binTriangle(project(a), project(b), project(c));
+		return;
+	}
+
+	// Clip against the near plane (z = -w), the other planes are handled
+	// by the screen bounds and the depth range test
+	ClipVertex polygon[4];
+	int count = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		const ClipVertex& current = *vertices[i];
+		const ClipVertex& next = *vertices[(i + 1) % 3];
+		const float dCurrent = current.position.z + current.position.w;
+		const float dNext = next.position.z + next.position.w;
+
+		if (dCurrent >= 0.0f)
+			polygon[count++] = current;
+		if ((dCurrent >= 0.0f) != (dNext >= 0.0f))
+		{
+			const float t = dCurrent / (dCurrent - dNext);
+			ClipVertex& v = polygon[count++];
+			v.position = glm::mix(current.position, next.position, t);
+			for (int k = 0; k < VaryingCount; ++k)
+				v.varyings[k] = current.varyings[k] + (next.varyings[k] - current.varyings[k]) * t;
+		}
+	}
+
+	for (int i = 1; i + 1 < count; ++i)
+		binTriangle(project(polygon[0]), project(polygon[i]), project(polygon[i + 1]));
+}
+
+void SoftwareRenderer::binTriangle(const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c)
+{
+	const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (std::fabs(area) < 1e-8f)
+		return;
+
+	const int minX = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))));
+	const int minY = std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))));
+	const int maxX = std::min(m_width - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))));
+	const int maxY = std::min(m_height - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))));
+	if (minX > maxX || minY > maxY)
+		return;
+
+	const uint32_t index = static_cast<uint32_t>(m_triangles.size());
+	Triangle triangle;
+	triangle.v[0] = a;
+	triangle.v[1] = b;
+	triangle.v[2] = c;
+	triangle.state = static_cast<uint32_t>(m_states.size() - 1);
+	m_triangles.push_back(triangle);
+
+	for (int ty = minY / TileSize; ty <= maxY / TileSize; ++ty)
+		for (int tx = minX / TileSize; tx <= maxX / TileSize; ++tx)
+			m_bins[static_cast<size_t>(ty) * m_tilesX + tx].push_back(index);
+}
+
+void SoftwareRenderer::finish()
+{
+	m_threadPool.parallelFor(m_bins.size(), [this](size_t tile) { rasterizeTile(static_cast<int>(tile)); });
+
+	m_clearPending = false;
+	m_triangles.clear();
+	for (auto& bin : m_bins)
+		bin.clear();
+
+	// Keep the current parameters for the next frame
+	m_states.erase(m_states.begin(), m_states.end() - 1);
+}
+
+void SoftwareRenderer::rasterizeTile(int tile)
+{
+	PROFILE_ZONE("SoftwareRenderer::rasterizeTile");
+	const int minX = (tile % m_tilesX) * TileSize;
+	const int minY = (tile / m_tilesX) * TileSize;
+	const int maxX = std::min(m_width, minX + TileSize) - 1;
+	const int maxY = std::min(m_height, minY + TileSize) - 1;
+
+	if (m_clearPending)
+	{
+		for (int y = minY; y <= maxY; ++y)
+		{
+			const size_t row = static_cast<size_t>(y) * m_width;
+			std::fill(m_color.begin() + row + minX, m_color.begin() + row + maxX + 1, m_clearColor);
+			std::fill(m_depth.begin() + row + minX, m_depth.begin() + row + maxX + 1, 1.0f);
+		}
+	}
+
+	// Triangles are in submission order, as OpenGL draws them
+	for (uint32_t index : m_bins[tile])
+		rasterizeTriangle(m_triangles[index], minX, minY, maxX, maxY);
+}
+
+void SoftwareRenderer::rasterizeTriangle(const Triangle& triangle, int tileMinX, int tileMinY, int tileMaxX, int tileMaxY)
+{
+	const ScreenVertex& v0 = triangle.v[0];
+	const ScreenVertex& v1 = triangle.v[1];
+	const ScreenVertex& v2 = triangle.v[2];
+	const Parameters& parameters = m_states[triangle.state];
+
+	const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	const float invArea = 1.0f / area;
+
+	// Edge functions scaled by 1 / area give the barycentric coordinates
+	// directly, whatever the winding of the triangle. Edge i is opposite
+	// to vertex i: b_i(x, y) = A_i * x + B_i * y + C_i.
+	const ScreenVertex* from[3] = { &v1, &v2, &v0 };
+	const ScreenVertex* to[3] = { &v2, &v0, &v1 };
+	float edgeA[3], edgeB[3], edgeC[3], edgeToPixels[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		const float dx = to[i]->x - from[i]->x;
+		const float dy = to[i]->y - from[i]->y;
+		edgeA[i] = -dy * invArea;
+		edgeB[i] = dx * invArea;
+		edgeC[i] = (dy * from[i]->x - dx * from[i]->y) * invArea;
+		// Barycentric coordinate to distance from the edge in pixels
+		edgeToPixels[i] = std::fabs(area) / std::max(1e-8f, std::sqrt(dx * dx + dy * dy));
+	}
+
+	const int minX = std::max(tileMinX, static_cast<int>(std::floor(std::min({ v0.x, v1.x, v2.x }))));
+	const int minY = std::max(tileMinY, static_cast<int>(std::floor(std::min({ v0.y, v1.y, v2.y }))));
+	const int maxX = std::min(tileMaxX, static_cast<int>(std::ceil(std::max({ v0.x, v1.x, v2.x }))));
+	const int maxY = std::min(tileMaxY, static_cast<int>(std::ceil(std::max({ v0.y, v1.y, v2.y }))));
+
+	const bool wireframe = parameters.shading == Shading::Wireframe;
+	const SimdFloat zero(0.0f), one(1.0f);
+	const SimdFloat lanes = SimdFloat::lanes() + SimdFloat(0.5f);
+	const SimdFloat endX(static_cast<float>(maxX + 1));
+
+	for (int y = minY; y <= maxY; ++y)
+	{
+		const float py = static_cast<float>(y) + 0.5f;
+		const SimdFloat rowB0(edgeB[0] * py + edgeC[0]);
+		const SimdFloat rowB1(edgeB[1] * py + edgeC[1]);
+		const SimdFloat rowB2(edgeB[2] * py + edgeC[2]);
+		const size_t row = static_cast<size_t>(y) * m_width;
+
+		for (int x = minX; x <= maxX; x += SimdFloat::Width)
+		{
+			const SimdFloat px = SimdFloat(static_cast<float>(x)) + lanes;
+			const SimdFloat b0 = SimdFloat(edgeA[0]) * px + rowB0;
+			const SimdFloat b1 = SimdFloat(edgeA[1]) * px + rowB1;
+			const SimdFloat b2 = SimdFloat(edgeA[2]) * px + rowB2;
+
+			SimdMask covered = (b0 >= zero) & (b1 >= zero) & (b2 >= zero) & (px < endX);
+			if (wireframe)
+			{
+				// Keep the pixels closer than one pixel to an edge
+				covered = covered & ((b0 * SimdFloat(edgeToPixels[0]) < one) | (b1 * SimdFloat(edgeToPixels[1]) < one) | (b2 * SimdFloat(edgeToPixels[2]) < one));
+			}
+			if (!covered.any())
+				continue;
+
+			// Depth test (GL_LESS) against the depth range
+			float* depthRow = m_depth.data() + row + x;
+			const SimdFloat z = b0 * SimdFloat(v0.z) + b1 * SimdFloat(v1.z) + b2 * SimdFloat(v2.z);
+			int visible = (covered & (z < SimdFloat::load(depthRow)) & (z >= zero) & (z <= one)).bits();
+			if (!visible)
+				continue;
+
+			alignas(32) float bary0[SimdFloat::Width], bary1[SimdFloat::Width], bary2[SimdFloat::Width], depths[SimdFloat::Width];
+			b0.store(bary0);
+			b1.store(bary1);
+			b2.store(bary2);
+			z.store(depths);
+
+			while (visible)
+			{
+				const int lane = lowestLane(visible);
+				visible &= visible - 1;
+
+				// Perspective correct interpolation of the varyings
+				const float invW = bary0[lane] * v0.invW + bary1[lane] * v1.invW + bary2[lane] * v2.invW;
+				const float w = 1.0f / invW;
+				float varyings[VaryingCount];
+				for (int k = 0; k < VaryingCount; ++k)
+					varyings[k] = (bary0[lane] * v0.varyings[k] + bary1[lane] * v1.varyings[k] + bary2[lane] * v2.varyings[k]) * w;
+
+				depthRow[lane] = depths[lane];
+				m_color[row + x + lane] = shade(parameters, varyings);
+			}
+		}
+	}
+}
+
+uint32_t SoftwareRenderer::shade(const Parameters& parameters, const float* varyings) const
+{
+	if (parameters.shading != Shading::Lit)
+		return packColor(basicShader(parameters));
+
+	const glm::vec3 fNormal(varyings[0], varyings[1], varyings[2]);
+	const glm::vec3 fEyeVector(varyings[3], varyings[4], varyings[5]);
+	const glm::vec3 fPosition(varyings[6], varyings[7], varyings[8]);
+	return packColor(litShader(parameters, fNormal, fEyeVector, fPosition));
+}
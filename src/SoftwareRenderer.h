@@ -0,0 +1,103 @@
+#pragma once
+#ifndef SOFTWARERENDERER_H
+#define SOFTWARERENDERER_H
+
+/**
+ * @file SoftwareRenderer.h
+ *
+ * @brief CPU rasterizer producing the same images as the OpenGL materials.
+ *
+ * Triangles are transformed and binned into screen tiles when drawn, then
+ * finish() rasterizes every tile as its own job on the thread pool. Pixels
+ * are covered 8 at a time with SimdFloat edge functions and shaded with
+ * ShaderPorts.h.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "ShaderPorts.h"
+#include "SphereGeometry.h"
+#include "ThreadPool.h"
+
+class SoftwareRenderer {
+public:
+	using Shading = ShadingModel;
+	using Parameters = ShadingParameters;
+
+	static const int TileSize = 64;
+
+	SoftwareRenderer(int width, int height, ThreadPool& threadPool = ThreadPool::global());
+
+	void resize(int width, int height);
+	inline int width() const { return m_width; }
+	inline int height() const { return m_height; }
+
+	void setParameters(const Parameters& parameters);
+	void setCamera(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPosition);
+
+	// Clear is applied by the tile jobs of the next finish()
+	void clear(const glm::vec4& color = glm::vec4(0.0f));
+	// Transform and bin the triangles of the mesh
+	void draw(const SphereMesh& mesh, const glm::mat4& model);
+	// Rasterize everything drawn since the last call
+	void finish();
+
+	// RGBA8, rows from top to bottom
+	inline const uint8_t* pixels() const { return reinterpret_cast<const uint8_t*>(m_color.data()); }
+	inline const float* depth() const { return m_depth.data(); }
+
+private:
+	static const int VaryingCount = 9; // fNormal, fEyeVector, fPosition
+
+	struct ClipVertex {
+		glm::vec4 position;
+		float varyings[VaryingCount];
+	};
+
+	// Vertex after the perspective divide, varyings are divided by w
+	struct ScreenVertex {
+		float x, y, z, invW;
+		float varyings[VaryingCount];
+	};
+
+	struct Triangle {
+		ScreenVertex v[3];
+		uint32_t state;
+	};
+
+	void setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+	void binTriangle(const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c);
+	void rasterizeTile(int tile);
+	void rasterizeTriangle(const Triangle& triangle, int minX, int minY, int maxX, int maxY);
+	uint32_t shade(const Parameters& parameters, const float* varyings) const;
+
+	ThreadPool& m_threadPool;
+
+	int m_width = 0;
+	int m_height = 0;
+	int m_tilesX = 0;
+	int m_tilesY = 0;
+
+	std::vector<uint32_t> m_color;
+	std::vector<float> m_depth;
+	bool m_clearPending = false;
+	uint32_t m_clearColor = 0;
+
+	glm::mat4 m_viewProjection = glm::mat4(1.0f);
+	glm::vec3 m_viewPosition = glm::vec3(0.0f);
+
+	// One entry per parameter change, referenced by the triangles
+	std::vector<Parameters> m_states;
+
+	std::vector<ClipVertex> m_clipVertices;
+	std::vector<Triangle> m_triangles;
+	std::vector<std::vector<uint32_t>> m_bins;
+};
+#endif
@@ -9,29 +9,58 @@
  */
 
 #include <cassert>
+#include <cstddef>
+#include <chrono>
+#include <iostream>
 
 #include "Sphere.h"
+#include "SphereGeometry.h"
 #include "Material.h"
+#include "InstanceBuffer.h"
+#include "ThreadPool.h"
+#include "Allocations.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "GLState.h"
 #include "glm/ext/matrix_transform.hpp"
 
-#define BUFFER_OFFSET(i) ((char *)NULL + (i))
+// Vertex buffer bindings of the vertex array, the positions then the normals
+// in the same buffer, and the instances
+static const GLuint PositionBinding = 0;
+static const GLuint NormalBinding = 1;
+static const GLuint InstanceBinding = 2;
 
-Sphere::Sphere(float radius, int longitude, int latitude, std::shared_ptr<const Material> material):
-	m_radius(radius), m_longitude(longitude), m_latitude(latitude), m_material(material),
-	m_VAOs(), m_buffers()
+// Below this many vertices, waking the threads costs more than it saves
+static const int ParallelGenerationVertices = 65536;
+
+static void generateMesh(float radius, int longitude, int latitude, SphereMesh& outMesh)
 {
-	assert(material != nullptr);
+	const bool parallel = SphereGeometry::vertexCount(longitude, latitude) >= ParallelGenerationVertices;
+	SphereGeometry(radius, longitude, latitude).generate(outMesh, SphereGeometry::Path::Simd, parallel ? &ThreadPool::global() : nullptr);
+}
 
+Sphere::Sphere(float radius, int longitude, int latitude):
+	m_radius(radius), m_longitude(longitude), m_latitude(latitude)
+{
 	updateNumTriSphere();
 	initGeometryBuffersAndVAO();
 }
 
-void Sphere::render()
+void Sphere::draw(GLuint firstInstance, GLsizei instanceCount)
 {
-	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	m_material->bind();
-	glBindVertexArray(m_VAOs[VAO_Sphere]);
-	glDrawElements(GL_TRIANGLES, m_numTriSphere * 3, GL_UNSIGNED_INT, 0);
+	// The material sets the polygon mode
+	GLState::bindVertexArray(m_VAO.id());
+	glDrawElementsInstancedBaseInstance(GL_TRIANGLES, m_numTriSphere * 3, GL_UNSIGNED_INT, 0, instanceCount, firstInstance);
+
+	RenderStats& stats = RenderStats::current();
+	++stats.drawCalls;
+	stats.triangles += static_cast<uint64_t>(m_numTriSphere) * instanceCount;
+	stats.vertices += static_cast<uint64_t>(m_numTriSphere) * 3 * instanceCount;
+}
+
+void Sphere::setInstanceBuffer(GLuint buffer, GLintptr offset)
+{
+	glVertexArrayVertexBuffer(m_VAO.id(), InstanceBinding, buffer, offset, sizeof(InstanceBuffer::Instance));
 }
 
 void Sphere::setRadius(float radius)
@@ -46,7 +75,7 @@ void Sphere::setRadius(float radius)
 
 void Sphere::setLongitude(int longitude)
 {
-	if (m_longitude == longitude || longitude < 1)
+	if (m_longitude == longitude || longitude < 1 || !fitsBudget(longitude, m_latitude))
 		return;
 
 	m_longitude = longitude;
@@ -57,7 +86,7 @@ void Sphere::setLongitude(int longitude)
 
 void Sphere::setLatitude(int latitude)
 {
-	if (m_latitude == latitude || latitude < 1)
+	if (m_latitude == latitude || latitude < 1 || !fitsBudget(m_longitude, latitude))
 		return;
 
 	m_latitude = latitude;
@@ -66,190 +95,117 @@ void Sphere::setLatitude(int latitude)
 	updateBuffers();
 }
 
-void Sphere::setMaterial(std::shared_ptr<const Material> material)
+void Sphere::setSubdivisions(int longitude, int latitude)
 {
-	assert(material != nullptr);
+	if (longitude < 1 || latitude < 1 || !fitsBudget(longitude, latitude))
+		return;
 
-	m_material = material;
+	m_longitude = longitude;
+	m_latitude = latitude;
+	updateNumTriSphere();
 
 	updateBuffers();
 }
 
 void Sphere::initGeometryBuffersAndVAO()
 {
-	std::vector<GLfloat> vertices;
-	std::vector<GLfloat> normals;
-	std::vector<GLuint> indices;
+	SphereMesh mesh;
+	generateMesh(m_radius, m_longitude, m_latitude, mesh);
 
-	generateVertices(vertices, normals);
-	generateIndices(indices);
-
-	initBuffersAndVAO(vertices, normals, indices);
-}
-
-void Sphere::generateVertices(std::vector<GLfloat>& outVertices, std::vector<GLfloat>& outNormals) const
-{
-	generateSurroundingVertices(outVertices, outNormals);
-	generateCapVertices(outVertices, outNormals);
-}
-
-static const float PI = 3.14159265f;
-
-void Sphere::generateSurroundingVertices(std::vector<GLfloat>& outVertices, std::vector<GLfloat>& outNormals) const
-{
-	// Le code de cette m�thode provient de la d�monstration de cr�ation d'une sph�re distribu�e en classe
-	const float thetaInc = 2.0f * PI / static_cast<float>(m_longitude);
-	const float phiInc = PI / static_cast<float>(m_latitude + 1);
-
-	for (int row = 0; row < m_latitude; ++row)
-	{
-		// You can think of Phi as sweeping the sphere from the South pole to the North pole
-		const float phi = PI - (static_cast<float>(row + 1) * phiInc);
-		for (int col = 0; col < m_longitude; ++col)
-		{
-			// You can think of Theta as circling around the sphere, East to West
-			float theta = col * thetaInc;
-
-			// Spherical coordinates 
-			glm::vec3 coordinates(m_radius * sin(theta) * sin(phi), m_radius * cos(phi), m_radius * cos(theta) * sin(phi));
-			outVertices.push_back(coordinates.x);
-			outVertices.push_back(coordinates.y);
-			outVertices.push_back(coordinates.z);
-
-			// Normal
-			// Since the center of the sphere is at (0,0,0), the normal direction of the points is just their normalized location. 
-			auto normal = glm::normalize(coordinates);
-			outNormals.push_back(normal.x);
-			outNormals.push_back(normal.y);
-			outNormals.push_back(normal.z);
-		}
-	}
+	initBuffersAndVAO(mesh.vertices, mesh.normals, mesh.indices);
 }
 
-void Sphere::generateCapVertices(std::vector<GLfloat>& outVertices, std::vector<GLfloat>& outNormals) const
-{
-	// Le code de cette m�thode provient de la d�monstration de cr�ation d'une sph�re distribu�e en classe
-	outVertices.push_back(0.0f);
-	outVertices.push_back(-m_radius);
-	outVertices.push_back(0.0f);
-
-	outNormals.push_back(0.0f);
-	outNormals.push_back(-1.0f);
-	outNormals.push_back(0.0f);
-
-	outVertices.push_back(0.0f);
-	outVertices.push_back(m_radius);
-	outVertices.push_back(0.0f);
-
-	outNormals.push_back(0.0f);
-	outNormals.push_back(1.0f);
-	outNormals.push_back(0.0f);
-}
-
-void Sphere::generateIndices(std::vector<GLuint>& outIndices) const
+void Sphere::initBuffersAndVAO(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& normals, const std::vector<GLuint>& indices)
 {
-	generateSurroundingIndices(outIndices);
-	generateCapIndices(outIndices);
-}
+	m_VAO = GpuHandle::create(GpuResourceType::VertexArray, "Sphere", "vertex array");
 
-void Sphere::generateSurroundingIndices(std::vector<GLuint>& outIndices) const
-{
-	// Le code de cette m�thode provient de la d�monstration de cr�ation d'une sph�re distribu�e en classe
-	for (int row = 0; row < m_latitude - 1; ++row)
+	const GLuint attributes[][2] = { { Material::PositionLocation, PositionBinding }, { Material::NormalLocation, NormalBinding } };
+	for (const auto& attribute : attributes)
 	{
-		unsigned int rowStart = row * m_longitude;
-		unsigned int topRowStart = rowStart + m_longitude;
-
-		for (int col = 0; col < m_longitude; ++col)
-		{
-			// Compute quad vertices
-			unsigned int v = rowStart + col;
-			unsigned int vi = (col < m_longitude - 1) ? v + 1 : rowStart;
-			unsigned int vj = topRowStart + col;
-			unsigned int vji = (col < m_longitude - 1) ? vj + 1 : topRowStart;
-
-			// Add to indices
-			outIndices.push_back(v);
-			outIndices.push_back(vi);
-			outIndices.push_back(vj);
-			outIndices.push_back(vi);
-			outIndices.push_back(vji);
-			outIndices.push_back(vj);
-		}
+		glEnableVertexArrayAttrib(m_VAO.id(), attribute[0]);
+		glVertexArrayAttribFormat(m_VAO.id(), attribute[0], 3, GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribBinding(m_VAO.id(), attribute[0], attribute[1]);
 	}
-}
 
-void Sphere::generateCapIndices(std::vector<GLuint>& outIndices) const
-{
-	// Le code de cette m�thode provient de la d�monstration de cr�ation d'une sph�re distribu�e en classe
-	for (int col = 0; col < m_longitude; ++col)
+	// One model matrix (a column per location) and material instance per instance
+	for (GLuint column = 0; column < 4; ++column)
 	{
-		outIndices.push_back(m_longitude * m_latitude);
-		outIndices.push_back((col < m_longitude - 1) ? col + 1 : 0);
-		outIndices.push_back(col);
-
-		unsigned int rowStart = (m_latitude - 1) * m_longitude;
-		outIndices.push_back(m_longitude * m_latitude + 1);
-		outIndices.push_back(rowStart + col);
-		outIndices.push_back((col < m_longitude - 1) ? (rowStart + col + 1) : rowStart);
+		const GLuint location = Material::ModelLocation + column;
+		glEnableVertexArrayAttrib(m_VAO.id(), location);
+		glVertexArrayAttribFormat(m_VAO.id(), location, 4, GL_FLOAT, GL_FALSE, static_cast<GLuint>(offsetof(InstanceBuffer::Instance, model) + column * sizeof(glm::vec4)));
+		glVertexArrayAttribBinding(m_VAO.id(), location, InstanceBinding);
 	}
-}
-
-
-void Sphere::initBuffersAndVAO(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& normals, const std::vector<GLuint>& indices)
-{
-	glGenVertexArrays(NumVAOs, m_VAOs);
-	glGenBuffers(NumBuffers, m_buffers);
+	glEnableVertexArrayAttrib(m_VAO.id(), Material::MaterialInstanceLocation);
+	glVertexArrayAttribIFormat(m_VAO.id(), Material::MaterialInstanceLocation, 1, GL_UNSIGNED_INT, static_cast<GLuint>(offsetof(InstanceBuffer::Instance, material)));
+	glVertexArrayAttribBinding(m_VAO.id(), Material::MaterialInstanceLocation, InstanceBinding);
+	glVertexArrayBindingDivisor(m_VAO.id(), InstanceBinding, 1);
 
 	fillBuffers(vertices, normals, indices);
-
-	// Do not desactivate EBO when the VAO is still activated
-	// as it will desactivate the EBO for this VAO 
-	glBindVertexArray(0);
 }
 
 void Sphere::fillBuffers(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& normals, const std::vector<GLuint>& indices)
 {
-	glBindVertexArray(m_VAOs[VAO_Sphere]);
+	const size_t vertexBytes = sizeof(GLfloat) * (vertices.size() + normals.size());
+	const size_t indexBytes = sizeof(GLuint) * indices.size();
+	if (!GpuResourceRegistry::instance().fits(m_VBO.bytes() + m_EBO.bytes(), vertexBytes + indexBytes)) {
+		// Only when the first mesh is already too big, the setters check the budget
+		std::cerr << "Sphere of " << m_longitude << "x" << m_latitude << " is over the GPU budget, it will not be drawn" << std::endl;
+		m_numTriSphere = 0;
+		return;
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, m_buffers[VBO_Sphere]);
-	glBufferData(GL_ARRAY_BUFFER, long(sizeof(GLfloat) * vertices.size() + long(sizeof(GLfloat) * vertices.size())), nullptr, GL_STATIC_DRAW);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, long(sizeof(GLfloat) * vertices.size()), vertices.data());
-	glBufferSubData(GL_ARRAY_BUFFER, long(sizeof(GLfloat) * vertices.size()), long(sizeof(GLfloat) * normals.size()), normals.data());
+	// Immutable storage can not be resized, a new mesh gets new buffers.
+	// The old ones go first, they do not count in the budget anymore
+	m_VBO.reset();
+	m_EBO.reset();
+	m_VBO = GpuHandle::create(GpuResourceType::Buffer, "Sphere", "vertex buffer");
+	m_EBO = GpuHandle::create(GpuResourceType::Buffer, "Sphere", "index buffer");
+	m_VBO.setBytes(vertexBytes);
+	m_EBO.setBytes(indexBytes);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_buffers[EBO_Sphere]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+	const GLsizeiptr positionBytes = static_cast<GLsizeiptr>(sizeof(GLfloat) * vertices.size());
+	glNamedBufferStorage(m_VBO.id(), static_cast<GLsizeiptr>(vertexBytes), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferSubData(m_VBO.id(), 0, positionBytes, vertices.data());
+	glNamedBufferSubData(m_VBO.id(), positionBytes, static_cast<GLsizeiptr>(sizeof(GLfloat) * normals.size()), normals.data());
+	glNamedBufferStorage(m_EBO.id(), static_cast<GLsizeiptr>(indexBytes), indices.data(), 0);
 
-	updateAttributeLocations(vertices);
+	glVertexArrayVertexBuffer(m_VAO.id(), PositionBinding, m_VBO.id(), 0, 3 * sizeof(GLfloat));
+	glVertexArrayVertexBuffer(m_VAO.id(), NormalBinding, m_VBO.id(), positionBytes, 3 * sizeof(GLfloat));
+	glVertexArrayElementBuffer(m_VAO.id(), m_EBO.id());
+
+	RenderStats::current().bufferBytes += vertexBytes + indexBytes;
 }
 
 void Sphere::updateBuffers()
 {
-	std::vector<GLfloat> vertices;
-	std::vector<GLfloat> normals;
-	std::vector<GLuint> indices;
+	PROFILE_ZONE("Sphere::updateBuffers");
+	ALLOCATION_TAG("Sphere::updateBuffers");
+	using Clock = std::chrono::steady_clock;
+	const auto start = Clock::now();
 
-	generateVertices(vertices, normals);
-	generateIndices(indices);
+	SphereMesh mesh;
+	generateMesh(m_radius, m_longitude, m_latitude, mesh);
+	const auto generated = Clock::now();
 
-	fillBuffers(vertices, normals, indices);
+	fillBuffers(mesh.vertices, mesh.normals, mesh.indices);
+
+	m_buildTimings.generation = std::chrono::duration<double, std::milli>(generated - start).count();
+	m_buildTimings.upload = std::chrono::duration<double, std::milli>(Clock::now() - generated).count();
 }
 
-void Sphere::updateAttributeLocations(const std::vector<GLfloat>& vertices)
+bool Sphere::fitsBudget(int longitude, int latitude) const
 {
-	int positionLocation = m_material->positionAttribLocation();
-	glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
-	glEnableVertexAttribArray(positionLocation);
+	const size_t vertexBytes = 6 * sizeof(GLfloat) * SphereGeometry::vertexCount(longitude, latitude);
+	const size_t indexBytes = 3 * sizeof(GLuint) * SphereGeometry::triangleCount(longitude, latitude);
+	if (GpuResourceRegistry::instance().fits(m_VBO.bytes() + m_EBO.bytes(), vertexBytes + indexBytes))
+		return true;
 
-	int normalLocation = m_material->normalAttribLocation();
-	if (normalLocation > -1)
-	{
-		glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(sizeof(GLfloat) * vertices.size()));
-		glEnableVertexAttribArray(normalLocation);
-	}
+	std::cerr << "Sphere of " << longitude << "x" << latitude << " would go over the GPU budget, kept at "
+		<< m_longitude << "x" << m_latitude << std::endl;
+	return false;
 }
 
 void Sphere::updateNumTriSphere()
 {
-	m_numTriSphere = m_longitude * (m_latitude - 1) * 2 + 2 * m_longitude;
+	m_numTriSphere = SphereGeometry::triangleCount(m_longitude, m_latitude);
 }
@@ -7,6 +7,9 @@
  *
  * @brief Sphere geometry that can be drawn on screen with a material.
  *
+ * The vertex array also reads the instances of an InstanceBuffer, a draw
+ * takes a range of them.
+ *
  * Martin Johnson
  * Billy-Joe Lacasse
  * William Lebel
@@ -15,51 +18,58 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
-#include <vector>
-#include <memory>
+#include "GpuResources.h"
 
-class Material;
+#include <vector>
 
 class Sphere {
 public:
-	Sphere(float radius, int longitude, int latitude, std::shared_ptr<const Material> material);
+	// Time spent by the last rebuild of the buffers, in milliseconds.
+	// Upload is the CPU time of the buffer calls, the driver may finish later.
+	struct BuildTimings {
+		double generation = 0.0;
+		double upload = 0.0;
+	};
+
+	Sphere(float radius, int longitude, int latitude);
 
-	void render();
+	// Draw instances of the instance buffer with the program already bound
+	void draw(GLuint firstInstance, GLsizei instanceCount);
+	// Read the instances from this buffer, starting at offset bytes (see InstanceBuffer)
+	void setInstanceBuffer(GLuint buffer, GLintptr offset);
+	inline GLuint vertexArrayId() const { return m_VAO.id(); }
 
 	void setRadius(float radius);
+	inline float radius() const { return m_radius; }
 	void setLongitude(int longitude);
 	void setLatitude(int latitude);
-	void setMaterial(std::shared_ptr<const Material> material);
+	// Change both subdivisions with a single rebuild, even if they are unchanged
+	void setSubdivisions(int longitude, int latitude);
+	inline int triangleCount() const { return m_numTriSphere; }
+	inline const BuildTimings& lastBuildTimings() const { return m_buildTimings; }
 
 private:
 	void initGeometryBuffersAndVAO();
 
-	void generateVertices(std::vector<GLfloat>& outVertices, std::vector<GLfloat>& outNormals) const;
-	void generateSurroundingVertices(std::vector<GLfloat>& outVertices, std::vector<GLfloat>& outNormals) const;
-	void generateCapVertices(std::vector<GLfloat>& outVertices, std::vector<GLfloat>& outNormals) const;
-
-	void generateIndices(std::vector<GLuint>& outIndices) const;
-	void generateSurroundingIndices(std::vector<GLuint>& outIndices) const;
-	void generateCapIndices(std::vector<GLuint>& outIndices) const;
-
 	void initBuffersAndVAO(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& normals, const std::vector<GLuint>& indices);
 	void fillBuffers(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& normals, const std::vector<GLuint>& indices);
 	void updateBuffers();
-	void updateAttributeLocations(const std::vector<GLfloat>& vertices);
+	// Whether the buffers of these subdivisions stay in the GPU budget (see GpuResourceRegistry)
+	bool fitsBudget(int longitude, int latitude) const;
 
 	void updateNumTriSphere();
 
-	std::shared_ptr<const Material> m_material;
-
 	int m_numTriSphere;
+	BuildTimings m_buildTimings;
 	
 	float m_radius;
 	int m_longitude;
 	int m_latitude;
 
-	enum VAO_IDs { VAO_Sphere, NumVAOs };
-	enum Buffer_IDs { VBO_Sphere, EBO_Sphere, NumBuffers };
-	GLuint m_VAOs[NumVAOs];
-	GLuint m_buffers[NumBuffers];
+	// The format of the vertex array is set once, new meshes only change its
+	// buffers. The same for every material (see Material::PositionLocation)
+	GpuHandle m_VAO;
+	GpuHandle m_VBO; // Immutable storage
+	GpuHandle m_EBO; // Immutable storage
 };
 #endif
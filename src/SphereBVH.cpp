@@ -0,0 +1,533 @@
+/**
+ * @file SphereBVH.cpp
+ *
+ * @brief Bounding volume hierarchy over the sphere instances of a Scene.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "SphereBVH.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+static const uint32_t InvalidIndex = ~0u;
+static const int BinCount = 16;
+static const int Width = SimdFloat::Width;
+static const int StackSize = 128;
+// Past this depth, nodes are split at the object median to bound the depth
+static const uint32_t MaxSahDepth = 64;
+// Rays and radius queries given to a thread at once by the batched versions
+static const size_t RaysPerChunk = 256;
+static const size_t QueriesPerChunk = 64;
+
+namespace
+{
+	struct Bounds {
+		glm::vec3 min = glm::vec3(1e30f);
+		glm::vec3 max = glm::vec3(-1e30f);
+
+		inline void grow(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+		inline void grow(const glm::vec3& point, float radius) { grow(point - glm::vec3(radius)); grow(point + glm::vec3(radius)); }
+		inline void grow(const Bounds& other) { min = glm::min(min, other.min); max = glm::max(max, other.max); }
+		inline float area() const
+		{
+			const glm::vec3 e = max - min;
+			return e.x < 0.0f ? 0.0f : 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+		}
+	};
+
+	// Slab test, returns the entry distance or a huge value on a miss
+	inline float intersectBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& inverseDirection, float tMin, float tMax)
+	{
+		const glm::vec3 t0 = (min - origin) * inverseDirection;
+		const glm::vec3 t1 = (max - origin) * inverseDirection;
+		const glm::vec3 tSmall = glm::min(t0, t1);
+		const glm::vec3 tBig = glm::max(t0, t1);
+		const float entry = std::max(std::max(tSmall.x, tSmall.y), std::max(tSmall.z, tMin));
+		const float exit = std::min(std::min(tBig.x, tBig.y), std::min(tBig.z, tMax));
+		return entry <= exit ? entry : 1e30f;
+	}
+
+	inline float distanceSquaredToBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& point)
+	{
+		const glm::vec3 d = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+		return glm::dot(d, d);
+	}
+}
+
+SphereBVH::SphereBVH()
+{
+}
+
+void SphereBVH::build(const Scene& scene)
+{
+	m_primitives.clear();
+	m_primitives.reserve(scene.size());
+	for (uint32_t i = 0; i < scene.size(); ++i)
+	{
+		if (!(scene.denseFlags(i) & Scene::Enabled))
+			continue;
+		Primitive primitive;
+		primitive.center = scene.densePosition(i);
+		primitive.radius = scene.denseRadius(i);
+		primitive.instance = scene.denseHandle(i);
+		m_primitives.push_back(primitive);
+	}
+
+	m_nodes.clear();
+	m_parents.clear();
+	m_blocks.clear();
+	m_blockLeaf.clear();
+	m_laneInstances.clear();
+	m_slotToLane.clear();
+	if (m_primitives.empty())
+		return;
+
+	const size_t expectedNodes = m_primitives.size() / 2 + 1;
+	m_nodes.reserve(expectedNodes);
+	m_parents.reserve(expectedNodes);
+	m_nodes.emplace_back();
+	m_parents.push_back(InvalidIndex);
+	buildNode(0, 0, static_cast<uint32_t>(m_primitives.size()), 0);
+
+	// Bounds of the inner nodes, children are always after their parent
+	for (size_t i = m_nodes.size(); i-- > 0;)
+	{
+		if (m_nodes[i].count == 0)
+			refitInner(static_cast<uint32_t>(i));
+	}
+
+	m_primitives.clear();
+	m_primitives.shrink_to_fit();
+}
+
+void SphereBVH::buildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth)
+{
+	const uint32_t count = end - begin;
+	if (count <= static_cast<uint32_t>(Width))
+	{
+		makeLeaf(nodeIndex, begin, end);
+		return;
+	}
+
+	Bounds centroidBounds;
+	for (uint32_t i = begin; i < end; ++i)
+		centroidBounds.grow(m_primitives[i].center);
+
+	// Binned SAH: evaluate BinCount - 1 split planes on each axis
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = 1e30f;
+	for (int axis = 0; axis < 3 && depth < MaxSahDepth; ++axis)
+	{
+		const float axisMin = centroidBounds.min[axis];
+		const float extent = centroidBounds.max[axis] - axisMin;
+		if (extent <= 0.0f)
+			continue;
+
+		Bounds binBounds[BinCount];
+		uint32_t binCount[BinCount] = {};
+		const float scale = BinCount / extent;
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const Primitive& primitive = m_primitives[i];
+			const int bin = std::min(BinCount - 1, static_cast<int>((primitive.center[axis] - axisMin) * scale));
+			binBounds[bin].grow(primitive.center, primitive.radius);
+			++binCount[bin];
+		}
+
+		// Sweep from the right to get the cost of every right side
+		float rightArea[BinCount - 1];
+		uint32_t rightCount[BinCount - 1];
+		Bounds right;
+		uint32_t rightSum = 0;
+		for (int b = BinCount - 1; b > 0; --b)
+		{
+			right.grow(binBounds[b]);
+			rightSum += binCount[b];
+			rightArea[b - 1] = right.area();
+			rightCount[b - 1] = rightSum;
+		}
+
+		Bounds left;
+		uint32_t leftSum = 0;
+		for (int b = 0; b < BinCount - 1; ++b)
+		{
+			left.grow(binBounds[b]);
+			leftSum += binCount[b];
+			const float cost = left.area() * leftSum + rightArea[b] * rightCount[b];
+			if (leftSum > 0 && rightCount[b] > 0 && cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	uint32_t middle = begin + count / 2;
+	if (bestAxis < 0)
+	{
+		// Object median along the largest axis
+		const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+		const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		std::nth_element(m_primitives.begin() + begin, m_primitives.begin() + middle, m_primitives.begin() + end,
+			[axis](const Primitive& a, const Primitive& b) { return a.center[axis] < b.center[axis]; });
+	}
+	else
+	{
+		const float axisMin = centroidBounds.min[bestAxis];
+		const float scale = BinCount / (centroidBounds.max[bestAxis] - axisMin);
+		auto first = m_primitives.begin() + begin;
+		auto split = std::partition(first, m_primitives.begin() + end, [&](const Primitive& primitive) {
+			const int bin = std::min(BinCount - 1, static_cast<int>((primitive.center[bestAxis] - axisMin) * scale));
+			return bin <= bestSplit;
+		});
+		middle = static_cast<uint32_t>(split - m_primitives.begin());
+	}
+	if (middle == begin || middle == end)
+	{
+		// Degenerate partition: split in the middle
+		middle = begin + count / 2;
+	}
+
+	const uint32_t left = static_cast<uint32_t>(m_nodes.size());
+	m_nodes[nodeIndex].leftOrBlock = left;
+	m_nodes[nodeIndex].count = 0;
+	m_nodes.emplace_back();
+	m_nodes.emplace_back();
+	m_parents.push_back(nodeIndex);
+	m_parents.push_back(nodeIndex);
+
+	buildNode(left, begin, middle, depth + 1);
+	buildNode(left + 1, middle, end, depth + 1);
+}
+
+void SphereBVH::makeLeaf(uint32_t nodeIndex, uint32_t begin, uint32_t end)
+{
+	const uint32_t blockIndex = static_cast<uint32_t>(m_blocks.size());
+	m_blocks.emplace_back();
+	m_blockLeaf.push_back(nodeIndex);
+	m_laneInstances.resize(m_laneInstances.size() + Width);
+
+	for (int lane = 0; lane < Width; ++lane)
+	{
+		const uint32_t laneIndex = blockIndex * Width + lane;
+		if (begin + lane < end)
+		{
+			const Primitive& primitive = m_primitives[begin + lane];
+			writeLane(laneIndex, primitive.center, primitive.radius);
+			m_laneInstances[laneIndex] = primitive.instance;
+
+			if (primitive.instance.slot >= m_slotToLane.size())
+				m_slotToLane.resize(primitive.instance.slot + 1, InvalidIndex);
+			m_slotToLane[primitive.instance.slot] = laneIndex;
+		}
+		else
+		{
+			// Padding: a negative squared radius never intersects anything
+			writeLane(laneIndex, glm::vec3(0.0f), 0.0f);
+			m_blocks[blockIndex].radiusSquared[lane] = -1.0f;
+		}
+	}
+
+	m_nodes[nodeIndex].leftOrBlock = blockIndex;
+	m_nodes[nodeIndex].count = end - begin;
+	refitLeaf(nodeIndex);
+}
+
+void SphereBVH::writeLane(uint32_t lane, const glm::vec3& center, float radius)
+{
+	Block& block = m_blocks[lane / Width];
+	block.x[lane % Width] = center.x;
+	block.y[lane % Width] = center.y;
+	block.z[lane % Width] = center.z;
+	block.radiusSquared[lane % Width] = radius * radius;
+}
+
+void SphereBVH::refitLeaf(uint32_t nodeIndex)
+{
+	Node& node = m_nodes[nodeIndex];
+	const Block& block = m_blocks[node.leftOrBlock];
+	Bounds bounds;
+	for (uint32_t lane = 0; lane < node.count; ++lane)
+		bounds.grow(glm::vec3(block.x[lane], block.y[lane], block.z[lane]), std::sqrt(block.radiusSquared[lane]));
+	node.min = bounds.min;
+	node.max = bounds.max;
+}
+
+void SphereBVH::refitInner(uint32_t nodeIndex)
+{
+	Node& node = m_nodes[nodeIndex];
+	const Node& left = m_nodes[node.leftOrBlock];
+	const Node& right = m_nodes[node.leftOrBlock + 1];
+	node.min = glm::min(left.min, right.min);
+	node.max = glm::max(left.max, right.max);
+}
+
+void SphereBVH::refit(const Scene& scene)
+{
+	for (size_t lane = 0; lane < m_laneInstances.size(); ++lane)
+	{
+		const SceneHandle instance = m_laneInstances[lane];
+		if (instance == SceneHandle() || !scene.isValid(instance))
+			continue;
+		writeLane(static_cast<uint32_t>(lane), scene.position(instance), scene.radius(instance));
+	}
+
+	for (size_t i = m_nodes.size(); i-- > 0;)
+	{
+		if (m_nodes[i].count > 0)
+			refitLeaf(static_cast<uint32_t>(i));
+		else
+			refitInner(static_cast<uint32_t>(i));
+	}
+}
+
+void SphereBVH::refit(const Scene& scene, const std::vector<SceneHandle>& moved)
+{
+	// Walk up from each moved sphere: O(moved * depth)
+	for (const SceneHandle& instance : moved)
+	{
+		if (instance.slot >= m_slotToLane.size() || m_slotToLane[instance.slot] == InvalidIndex || !scene.isValid(instance))
+			continue;
+
+		const uint32_t lane = m_slotToLane[instance.slot];
+		writeLane(lane, scene.position(instance), scene.radius(instance));
+
+		uint32_t node = m_blockLeaf[lane / Width];
+		refitLeaf(node);
+		for (node = m_parents[node]; node != InvalidIndex; node = m_parents[node])
+			refitInner(node);
+	}
+}
+
+RayHit SphereBVH::raycast(const Ray& ray) const
+{
+	RayHit result;
+	if (m_nodes.empty())
+		return result;
+
+	const glm::vec3 inverseDirection = 1.0f / ray.direction;
+	float closest = ray.tMax;
+
+	const SimdFloat originX(ray.origin.x), originY(ray.origin.y), originZ(ray.origin.z);
+	const SimdFloat directionX(ray.direction.x), directionY(ray.direction.y), directionZ(ray.direction.z);
+	const SimdFloat tMin(ray.tMin);
+
+	// Entry distance of the nodes kept with them, to skip the ones that are
+	// behind the closest hit found since they were pushed
+	uint32_t stack[StackSize];
+	float stackEntry[StackSize];
+	int stackSize = 0;
+	uint32_t nodeIndex = 0;
+	if (intersectBox(m_nodes[0].min, m_nodes[0].max, ray.origin, inverseDirection, ray.tMin, closest) >= 1e30f)
+		return result;
+
+	while (true)
+	{
+		const Node& node = m_nodes[nodeIndex];
+		if (node.count > 0)
+		{
+			// Test the whole block at once
+			const Block& block = m_blocks[node.leftOrBlock];
+			const SimdFloat ocX = SimdFloat::load(block.x) - originX;
+			const SimdFloat ocY = SimdFloat::load(block.y) - originY;
+			const SimdFloat ocZ = SimdFloat::load(block.z) - originZ;
+			const SimdFloat b = ocX * directionX + ocY * directionY + ocZ * directionZ;
+			const SimdFloat c = ocX * ocX + ocY * ocY + ocZ * ocZ - SimdFloat::load(block.radiusSquared);
+			const SimdFloat discriminant = b * b - c;
+			const SimdMask valid = discriminant >= SimdFloat(0.0f);
+
+			if (valid.any())
+			{
+				const SimdFloat root = simdSqrt(simdMax(discriminant, SimdFloat(0.0f)));
+				const SimdFloat tNear = b - root;
+				// Origin inside the sphere: use the far intersection
+				const SimdFloat t = simdSelect(tNear >= tMin, tNear, b + root);
+				int hits = (valid & (t >= tMin) & (t < SimdFloat(closest))).bits();
+				if (hits)
+				{
+					alignas(32) float ts[Width];
+					t.store(ts);
+					while (hits)
+					{
+						const int lane = lowestLane(hits);
+						hits &= hits - 1;
+						if (ts[lane] < closest)
+						{
+							closest = ts[lane];
+							result.t = closest;
+							result.instance = m_laneInstances[node.leftOrBlock * Width + lane];
+						}
+					}
+				}
+			}
+		}
+		else
+		{
+			// Visit the nearest child first
+			uint32_t near = node.leftOrBlock;
+			uint32_t far = near + 1;
+			float tNear = intersectBox(m_nodes[near].min, m_nodes[near].max, ray.origin, inverseDirection, ray.tMin, closest);
+			float tFar = intersectBox(m_nodes[far].min, m_nodes[far].max, ray.origin, inverseDirection, ray.tMin, closest);
+			if (tFar < tNear)
+			{
+				std::swap(near, far);
+				std::swap(tNear, tFar);
+			}
+			if (tNear < 1e30f)
+			{
+				if (tFar < 1e30f)
+				{
+					// The depth of the tree is bounded by the build, see MaxSahDepth
+					assert(stackSize < StackSize);
+					stack[stackSize] = far;
+					stackEntry[stackSize++] = tFar;
+				}
+				nodeIndex = near;
+				continue;
+			}
+		}
+
+		// Pop the next node that can still hold a closer hit
+		bool found = false;
+		while (stackSize > 0)
+		{
+			--stackSize;
+			if (stackEntry[stackSize] < closest)
+			{
+				nodeIndex = stack[stackSize];
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			break;
+	}
+
+	return result;
+}
+
+void SphereBVH::raycast(const Ray* rays, RayHit* hits, size_t count) const
+{
+	auto traceChunk = [this, rays, hits, count](size_t chunk) {
+		const size_t end = std::min(count, (chunk + 1) * RaysPerChunk);
+		for (size_t i = chunk * RaysPerChunk; i < end; ++i)
+			hits[i] = raycast(rays[i]);
+	};
+
+	const size_t chunks = (count + RaysPerChunk - 1) / RaysPerChunk;
+	if (chunks > 1)
+		ThreadPool::global().parallelFor(chunks, traceChunk);
+	else if (chunks == 1)
+		traceChunk(0);
+}
+
+void SphereBVH::pick(const glm::mat4& viewProjection, const glm::vec2* ndcPoints, RayHit* hits, size_t count) const
+{
+	const glm::mat4 inverse = glm::inverse(viewProjection);
+	for (size_t i = 0; i < count; ++i)
+	{
+		glm::vec4 nearPoint = inverse * glm::vec4(ndcPoints[i], -1.0f, 1.0f);
+		glm::vec4 farPoint = inverse * glm::vec4(ndcPoints[i], 1.0f, 1.0f);
+		nearPoint /= nearPoint.w;
+		farPoint /= farPoint.w;
+
+		Ray ray;
+		ray.origin = glm::vec3(nearPoint);
+		ray.direction = glm::vec3(farPoint) - ray.origin;
+		ray.tMax = glm::length(ray.direction);
+		ray.direction /= ray.tMax;
+		hits[i] = raycast(ray);
+	}
+}
+
+void SphereBVH::queryRadius(const glm::vec3& center, float radius, std::vector<SceneHandle>& outInstances) const
+{
+	if (m_nodes.empty())
+		return;
+
+	const SimdFloat centerX(center.x), centerY(center.y), centerZ(center.z);
+	const SimdFloat queryRadius(radius);
+
+	uint32_t stack[StackSize];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+		if (distanceSquaredToBox(node.min, node.max, center) > radius * radius)
+			continue;
+
+		if (node.count > 0)
+		{
+			// Overlap when |c - p| <= r + R, i.e. d^2 - R^2 - r^2 <= 2rR
+			const Block& block = m_blocks[node.leftOrBlock];
+			const SimdFloat dx = SimdFloat::load(block.x) - centerX;
+			const SimdFloat dy = SimdFloat::load(block.y) - centerY;
+			const SimdFloat dz = SimdFloat::load(block.z) - centerZ;
+			const SimdFloat radiusSquared = SimdFloat::load(block.radiusSquared);
+			const SimdFloat lhs = dx * dx + dy * dy + dz * dz - radiusSquared - queryRadius * queryRadius;
+			const SimdFloat rhs = SimdFloat(2.0f) * queryRadius * simdSqrt(simdMax(radiusSquared, SimdFloat(0.0f)));
+			int overlaps = ((lhs <= rhs) & (radiusSquared >= SimdFloat(0.0f))).bits();
+			while (overlaps)
+			{
+				const int lane = lowestLane(overlaps);
+				overlaps &= overlaps - 1;
+				outInstances.push_back(m_laneInstances[node.leftOrBlock * Width + lane]);
+			}
+		}
+		else
+		{
+			assert(stackSize + 2 <= StackSize);
+			stack[stackSize++] = node.leftOrBlock;
+			stack[stackSize++] = node.leftOrBlock + 1;
+		}
+	}
+}
+
+void SphereBVH::queryRadius(const glm::vec3* centers, const float* radii, size_t count,
+	std::vector<SceneHandle>& outInstances, std::vector<uint32_t>& outOffsets) const
+{
+	outInstances.clear();
+	outOffsets.resize(count + 1);
+	const size_t chunks = (count + QueriesPerChunk - 1) / QueriesPerChunk;
+	if (chunks <= 1)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			outOffsets[i] = static_cast<uint32_t>(outInstances.size());
+			queryRadius(centers[i], radii[i], outInstances);
+		}
+		outOffsets[count] = static_cast<uint32_t>(outInstances.size());
+		return;
+	}
+
+	// Each chunk collects its results with offsets relative to its own list,
+	// the lists are then joined in query order
+	std::vector<std::vector<SceneHandle>> chunkInstances(chunks);
+	ThreadPool::global().parallelFor(chunks, [&](size_t chunk) {
+		const size_t end = std::min(count, (chunk + 1) * QueriesPerChunk);
+		for (size_t i = chunk * QueriesPerChunk; i < end; ++i)
+		{
+			outOffsets[i] = static_cast<uint32_t>(chunkInstances[chunk].size());
+			queryRadius(centers[i], radii[i], chunkInstances[chunk]);
+		}
+	});
+
+	for (size_t chunk = 0; chunk < chunks; ++chunk)
+	{
+		const uint32_t base = static_cast<uint32_t>(outInstances.size());
+		const size_t end = std::min(count, (chunk + 1) * QueriesPerChunk);
+		for (size_t i = chunk * QueriesPerChunk; i < end; ++i)
+			outOffsets[i] += base;
+		outInstances.insert(outInstances.end(), chunkInstances[chunk].begin(), chunkInstances[chunk].end());
+	}
+	outOffsets[count] = static_cast<uint32_t>(outInstances.size());
+}
@@ -0,0 +1,109 @@
+#pragma once
+#ifndef SPHEREBVH_H
+#define SPHEREBVH_H
+
+/**
+ * @file SphereBVH.h
+ *
+ * @brief Bounding volume hierarchy over the sphere instances of a Scene.
+ *
+ * Built with a binned surface area heuristic. Each leaf holds at most one
+ * block of SimdFloat::Width spheres that are tested against a ray all at
+ * once. Moving spheres can be handled by refitting the bounds instead of
+ * rebuilding the tree.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Scene.h"
+#include "Simd.h"
+
+struct Ray {
+	glm::vec3 origin;
+	glm::vec3 direction; // Normalized
+	float tMin = 0.0f;
+	float tMax = 1e30f;
+};
+
+struct RayHit {
+	SceneHandle instance; // Invalid when nothing was hit
+	float t = 1e30f;
+
+	inline bool hit() const { return instance != SceneHandle(); }
+};
+
+class SphereBVH {
+public:
+	SphereBVH();
+
+	// Build the tree over all the enabled instances of the scene
+	void build(const Scene& scene);
+	// Update the bounds after instances moved or changed radius.
+	// The set of instances must be the same as when the tree was built.
+	void refit(const Scene& scene);
+	void refit(const Scene& scene, const std::vector<SceneHandle>& moved);
+
+	inline bool empty() const { return m_nodes.empty(); }
+	inline size_t nodeCount() const { return m_nodes.size(); }
+
+	// Closest intersection along the ray
+	RayHit raycast(const Ray& ray) const;
+	// Batched version, large batches are split over ThreadPool::global().
+	// Must not be called from a job of that pool.
+	void raycast(const Ray* rays, RayHit* hits, size_t count) const;
+
+	// Pick through points given in normalized device coordinates
+	void pick(const glm::mat4& viewProjection, const glm::vec2* ndcPoints, RayHit* hits, size_t count) const;
+
+	// Instances overlapping the sphere (center, radius)
+	void queryRadius(const glm::vec3& center, float radius, std::vector<SceneHandle>& outInstances) const;
+	// Batched version: results of query i are outInstances[outOffsets[i], outOffsets[i + 1]).
+	// Split over ThreadPool::global() like the batched raycast.
+	void queryRadius(const glm::vec3* centers, const float* radii, size_t count,
+		std::vector<SceneHandle>& outInstances, std::vector<uint32_t>& outOffsets) const;
+
+private:
+	struct Node {
+		glm::vec3 min;
+		uint32_t leftOrBlock; // Left child (right is left + 1), or block index for leaves
+		glm::vec3 max;
+		uint32_t count;       // Number of spheres in the leaf block, 0 for inner nodes
+	};
+
+	// Spheres of a leaf, laid out for SimdFloat
+	struct alignas(32) Block {
+		float x[SimdFloat::Width];
+		float y[SimdFloat::Width];
+		float z[SimdFloat::Width];
+		float radiusSquared[SimdFloat::Width];
+	};
+
+	struct Primitive {
+		glm::vec3 center;
+		float radius;
+		SceneHandle instance;
+	};
+
+	void buildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth);
+	void makeLeaf(uint32_t nodeIndex, uint32_t begin, uint32_t end);
+	void refitLeaf(uint32_t nodeIndex);
+	void refitInner(uint32_t nodeIndex);
+	void writeLane(uint32_t lane, const glm::vec3& center, float radius);
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_parents;
+	std::vector<Block> m_blocks;
+	std::vector<uint32_t> m_blockLeaf;
+	std::vector<SceneHandle> m_laneInstances;
+	std::vector<uint32_t> m_slotToLane; // Scene slot -> block * Width + lane
+
+	std::vector<Primitive> m_primitives; // Build scratch
+};
+#endif
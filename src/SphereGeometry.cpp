@@ -0,0 +1,339 @@
+/**
+ * @file SphereGeometry.cpp
+ *
+ * @brief CPU side generation of the vertices and indices of a sphere.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "SphereGeometry.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+void SphereMesh::clear()
+{
+	vertices.clear();
+	normals.clear();
+	indices.clear();
+}
+
+SphereGeometry::SphereGeometry(float radius, int longitude, int latitude) :
+	m_radius(radius), m_longitude(longitude), m_latitude(latitude)
+{
+}
+
+void SphereGeometry::generate(SphereMesh& outMesh, Path path, ThreadPool* threadPool) const
+{
+	if (path != Path::Reference) {
+		generateInPlace(outMesh, path == Path::Simd, threadPool);
+		return;
+	}
+
+	outMesh.clear();
+	outMesh.vertices.reserve(3 * vertexCount(m_longitude, m_latitude));
+	outMesh.normals.reserve(3 * vertexCount(m_longitude, m_latitude));
+	outMesh.indices.reserve(3 * triangleCount(m_longitude, m_latitude));
+
+	generateVertices(outMesh.vertices, outMesh.normals);
+	generateIndices(outMesh.indices);
+}
+
+const char* SphereGeometry::pathName(Path path)
+{
+	switch (path)
+	{
+	case Path::Reference:
+		return "reference";
+	case Path::Scalar:
+		return "scalar";
+	case Path::Simd:
+		return simdPathName();
+	}
+	return "";
+}
+
+int SphereGeometry::triangleCount(int longitude, int latitude)
+{
+	return longitude * (latitude - 1) * 2 + 2 * longitude;
+}
+
+int SphereGeometry::vertexCount(int longitude, int latitude)
+{
+	return longitude * latitude + 2;
+}
+
+void SphereGeometry::generateVertices(std::vector<float>& outVertices, std::vector<float>& outNormals) const
+{
+	generateSurroundingVertices(outVertices, outNormals);
+	generateCapVertices(outVertices, outNormals);
+}
+
+static const float PI = 3.14159265f;
+
+void SphereGeometry::generateSurroundingVertices(std::vector<float>& outVertices, std::vector<float>& outNormals) const
+{
+	// Le code de cette m�thode provient de la d�monstration de cr�ation d'une sph�re distribu�e en classe
+	const float thetaInc = 2.0f * PI / static_cast<float>(m_longitude);
+	const float phiInc = PI / static_cast<float>(m_latitude + 1);
+
+	for (int row = 0; row < m_latitude; ++row)
+	{
+		// You can think of Phi as sweeping the sphere from the South pole to the North pole
+		const float phi = PI - (static_cast<float>(row + 1) * phiInc);
+		for (int col = 0; col < m_longitude; ++col)
+		{
+			// You can think of Theta as circling around the sphere, East to West
+			float theta = col * thetaInc;
+
+			// Spherical coordinates 
+			glm::vec3 coordinates(m_radius * sin(theta) * sin(phi), m_radius * cos(phi), m_radius * cos(theta) * sin(phi));
+			outVertices.push_back(coordinates.x);
+			outVertices.push_back(coordinates.y);
+			outVertices.push_back(coordinates.z);
+
+			// Normal
+			// Since the center of the sphere is at (0,0,0), the normal direction of the points is just their normalized location. 
+			auto normal = glm::normalize(coordinates);
+			outNormals.push_back(normal.x);
+			outNormals.push_back(normal.y);
+			outNormals.push_back(normal.z);
+		}
+	}
+}
+
+void SphereGeometry::generateCapVertices(std::vector<float>& outVertices, std::vector<float>& outNormals) const
+{
+	// Le code de cette m�thode provient de la d�monstration de cr�ation d'une sph�re distribu�e en classe
+	outVertices.push_back(0.0f);
+	outVertices.push_back(-m_radius);
+	outVertices.push_back(0.0f);
+
+	outNormals.push_back(0.0f);
+	outNormals.push_back(-1.0f);
+	outNormals.push_back(0.0f);
+
+	outVertices.push_back(0.0f);
+	outVertices.push_back(m_radius);
+	outVertices.push_back(0.0f);
+
+	outNormals.push_back(0.0f);
+	outNormals.push_back(1.0f);
+	outNormals.push_back(0.0f);
+}
+
+void SphereGeometry::generateIndices(std::vector<uint32_t>& outIndices) const
+{
+	generateSurroundingIndices(outIndices);
+	generateCapIndices(outIndices);
+}
+
+void SphereGeometry::generateSurroundingIndices(std::vector<uint32_t>& outIndices) const
+{
+	// Le code de cette m�thode provient de la d�monstration de cr�ation d'une sph�re distribu�e en classe
+	for (int row = 0; row < m_latitude - 1; ++row)
+	{
+		unsigned int rowStart = row * m_longitude;
+		unsigned int topRowStart = rowStart + m_longitude;
+
+		for (int col = 0; col < m_longitude; ++col)
+		{
+			// Compute quad vertices
+			unsigned int v = rowStart + col;
+			unsigned int vi = (col < m_longitude - 1) ? v + 1 : rowStart;
+			unsigned int vj = topRowStart + col;
+			unsigned int vji = (col < m_longitude - 1) ? vj + 1 : topRowStart;
+
+			// Add to indices
+			outIndices.push_back(v);
+			outIndices.push_back(vi);
+			outIndices.push_back(vj);
+			outIndices.push_back(vi);
+			outIndices.push_back(vji);
+			outIndices.push_back(vj);
+		}
+	}
+}
+
+void SphereGeometry::generateCapIndices(std::vector<uint32_t>& outIndices) const
+{
+	// Le code de cette m�thode provient de la d�monstration de cr�ation d'une sph�re distribu�e en classe
+	for (int col = 0; col < m_longitude; ++col)
+	{
+		outIndices.push_back(m_longitude * m_latitude);
+		outIndices.push_back((col < m_longitude - 1) ? col + 1 : 0);
+		outIndices.push_back(col);
+
+		unsigned int rowStart = (m_latitude - 1) * m_longitude;
+		outIndices.push_back(m_longitude * m_latitude + 1);
+		outIndices.push_back(rowStart + col);
+		outIndices.push_back((col < m_longitude - 1) ? (rowStart + col + 1) : rowStart);
+	}
+}
+
+namespace
+{
+	// Angles shared by every row. The reference version evaluates the
+	// trigonometry in double precision, the scalar path does the same so
+	// that both give the same vertices.
+	struct AngleTables {
+		std::vector<double> sinTheta;
+		std::vector<double> cosTheta;
+		std::vector<float> sinThetaSimd; // Padded to a multiple of SimdFloat::Width
+		std::vector<float> cosThetaSimd;
+	};
+
+	void generateVertexRows(float radius, int longitude, int latitude, const AngleTables& tables, bool simd,
+		int firstRow, int endRow, float* outVertices, float* outNormals)
+	{
+		const float phiInc = PI / static_cast<float>(latitude + 1);
+		for (int row = firstRow; row < endRow; ++row)
+		{
+			const float phi = PI - (static_cast<float>(row + 1) * phiInc);
+			const double sinPhi = std::sin(static_cast<double>(phi));
+			const double cosPhi = std::cos(static_cast<double>(phi));
+			float* vertices = outVertices + static_cast<size_t>(row) * longitude * 3;
+			float* normals = outNormals + static_cast<size_t>(row) * longitude * 3;
+
+			int col = 0;
+			if (simd)
+			{
+				const SimdFloat radiusSinPhi(static_cast<float>(radius * sinPhi));
+				const SimdFloat y(static_cast<float>(radius * cosPhi));
+				alignas(32) float xs[SimdFloat::Width], ys[SimdFloat::Width], zs[SimdFloat::Width];
+				alignas(32) float nxs[SimdFloat::Width], nys[SimdFloat::Width], nzs[SimdFloat::Width];
+				for (; col + SimdFloat::Width <= longitude; col += SimdFloat::Width)
+				{
+					const SimdFloat x = radiusSinPhi * SimdFloat::load(&tables.sinThetaSimd[col]);
+					const SimdFloat z = radiusSinPhi * SimdFloat::load(&tables.cosThetaSimd[col]);
+					const SimdFloat invLength = SimdFloat(1.0f) / simdSqrt(x * x + y * y + z * z);
+					x.store(xs);
+					y.store(ys);
+					z.store(zs);
+					(x * invLength).store(nxs);
+					(y * invLength).store(nys);
+					(z * invLength).store(nzs);
+
+					// Interleave the components
+					for (int lane = 0; lane < SimdFloat::Width; ++lane)
+					{
+						float* vertex = vertices + 3 * (col + lane);
+						float* normal = normals + 3 * (col + lane);
+						vertex[0] = xs[lane];
+						vertex[1] = ys[lane];
+						vertex[2] = zs[lane];
+						normal[0] = nxs[lane];
+						normal[1] = nys[lane];
+						normal[2] = nzs[lane];
+					}
+				}
+			}
+
+			for (; col < longitude; ++col)
+			{
+				const glm::vec3 coordinates(radius * tables.sinTheta[col] * sinPhi, radius * cosPhi, radius * tables.cosTheta[col] * sinPhi);
+				const glm::vec3 normal = glm::normalize(coordinates);
+				vertices[3 * col] = coordinates.x;
+				vertices[3 * col + 1] = coordinates.y;
+				vertices[3 * col + 2] = coordinates.z;
+				normals[3 * col] = normal.x;
+				normals[3 * col + 1] = normal.y;
+				normals[3 * col + 2] = normal.z;
+			}
+		}
+	}
+
+	// Two triangles per quad between a row and the next one
+	void generateIndexRows(int longitude, int firstRow, int endRow, uint32_t* outIndices)
+	{
+		for (int row = firstRow; row < endRow; ++row)
+		{
+			const uint32_t rowStart = row * longitude;
+			const uint32_t topRowStart = rowStart + longitude;
+			uint32_t* indices = outIndices + static_cast<size_t>(row) * longitude * 6;
+
+			for (int col = 0; col < longitude; ++col)
+			{
+				const uint32_t v = rowStart + col;
+				const uint32_t vi = (col < longitude - 1) ? v + 1 : rowStart;
+				const uint32_t vj = topRowStart + col;
+				const uint32_t vji = (col < longitude - 1) ? vj + 1 : topRowStart;
+
+				indices[6 * col] = v;
+				indices[6 * col + 1] = vi;
+				indices[6 * col + 2] = vj;
+				indices[6 * col + 3] = vi;
+				indices[6 * col + 4] = vji;
+				indices[6 * col + 5] = vj;
+			}
+		}
+	}
+}
+
+void SphereGeometry::generateInPlace(SphereMesh& outMesh, bool simd, ThreadPool* threadPool) const
+{
+	const size_t vertexTotal = static_cast<size_t>(vertexCount(m_longitude, m_latitude));
+	const size_t triangleTotal = static_cast<size_t>(triangleCount(m_longitude, m_latitude));
+	outMesh.vertices.resize(3 * vertexTotal);
+	outMesh.normals.resize(3 * vertexTotal);
+	outMesh.indices.resize(3 * triangleTotal);
+
+	AngleTables tables;
+	const float thetaInc = 2.0f * PI / static_cast<float>(m_longitude);
+	const size_t padded = (m_longitude + SimdFloat::Width - 1) / SimdFloat::Width * SimdFloat::Width;
+	tables.sinTheta.resize(m_longitude);
+	tables.cosTheta.resize(m_longitude);
+	tables.sinThetaSimd.assign(padded, 0.0f);
+	tables.cosThetaSimd.assign(padded, 0.0f);
+	for (int col = 0; col < m_longitude; ++col)
+	{
+		const float theta = col * thetaInc;
+		tables.sinTheta[col] = std::sin(static_cast<double>(theta));
+		tables.cosTheta[col] = std::cos(static_cast<double>(theta));
+		tables.sinThetaSimd[col] = static_cast<float>(tables.sinTheta[col]);
+		tables.cosThetaSimd[col] = static_cast<float>(tables.cosTheta[col]);
+	}
+
+	// Each job writes its own rows of vertices and of quads
+	const int rowsPerJob = threadPool ? std::max(1, m_latitude / static_cast<int>(4 * (threadPool->threadCount() + 1))) : m_latitude;
+	const int jobCount = (m_latitude + rowsPerJob - 1) / rowsPerJob;
+	auto job = [&](size_t index) {
+		const int firstRow = static_cast<int>(index) * rowsPerJob;
+		const int endRow = std::min(m_latitude, firstRow + rowsPerJob);
+		generateVertexRows(m_radius, m_longitude, m_latitude, tables, simd, firstRow, endRow, outMesh.vertices.data(), outMesh.normals.data());
+		generateIndexRows(m_longitude, firstRow, std::min(endRow, m_latitude - 1), outMesh.indices.data());
+	};
+	if (threadPool)
+		threadPool->parallelFor(jobCount, job);
+	else
+		for (int i = 0; i < jobCount; ++i)
+			job(i);
+
+	// Poles
+	float* poles = outMesh.vertices.data() + 3 * (vertexTotal - 2);
+	float* poleNormals = outMesh.normals.data() + 3 * (vertexTotal - 2);
+	const float southAndNorth[6] = { 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+	for (int i = 0; i < 6; ++i)
+	{
+		poles[i] = southAndNorth[i] * m_radius;
+		poleNormals[i] = southAndNorth[i];
+	}
+
+	uint32_t* caps = outMesh.indices.data() + static_cast<size_t>(m_latitude - 1) * m_longitude * 6;
+	const uint32_t rowStart = (m_latitude - 1) * m_longitude;
+	for (int col = 0; col < m_longitude; ++col)
+	{
+		caps[6 * col] = m_longitude * m_latitude;
+		caps[6 * col + 1] = (col < m_longitude - 1) ? col + 1 : 0;
+		caps[6 * col + 2] = col;
+		caps[6 * col + 3] = m_longitude * m_latitude + 1;
+		caps[6 * col + 4] = rowStart + col;
+		caps[6 * col + 5] = (col < m_longitude - 1) ? (rowStart + col + 1) : rowStart;
+	}
+}
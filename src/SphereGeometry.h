@@ -0,0 +1,68 @@
+#pragma once
+#ifndef SPHEREGEOMETRY_H
+#define SPHEREGEOMETRY_H
+
+/**
+ * @file SphereGeometry.h
+ *
+ * @brief CPU side generation of the vertices and indices of a sphere.
+ *
+ * Does not depend on OpenGL so it can be used without a context (software
+ * renderers, benchmarks). Rows of the sphere are independent, so they can be
+ * split between the threads of a ThreadPool.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Positions and normals are stored as consecutive xyz triplets
+struct SphereMesh {
+	std::vector<float> vertices;
+	std::vector<float> normals;
+	std::vector<uint32_t> indices;
+
+	void clear();
+	inline size_t vertexCount() const { return vertices.size() / 3; }
+	inline size_t triangleCount() const { return indices.size() / 3; }
+};
+
+class SphereGeometry {
+public:
+	enum class Path {
+		Reference, // Original per vertex version, single threaded
+		Scalar,    // Sine and cosine tables, rows written in place
+		Simd       // Same as Scalar, SimdFloat::Width vertices at a time
+	};
+
+	SphereGeometry(float radius, int longitude, int latitude);
+
+	// Rows are split between the threads of the pool when one is given
+	void generate(SphereMesh& outMesh, Path path = Path::Simd, ThreadPool* threadPool = nullptr) const;
+
+	static const char* pathName(Path path);
+	static int triangleCount(int longitude, int latitude);
+	static int vertexCount(int longitude, int latitude);
+
+private:
+	void generateVertices(std::vector<float>& outVertices, std::vector<float>& outNormals) const;
+	void generateSurroundingVertices(std::vector<float>& outVertices, std::vector<float>& outNormals) const;
+	void generateCapVertices(std::vector<float>& outVertices, std::vector<float>& outNormals) const;
+
+	void generateInPlace(SphereMesh& outMesh, bool simd, ThreadPool* threadPool) const;
+
+	void generateIndices(std::vector<uint32_t>& outIndices) const;
+	void generateSurroundingIndices(std::vector<uint32_t>& outIndices) const;
+	void generateCapIndices(std::vector<uint32_t>& outIndices) const;
+
+	float m_radius;
+	int m_longitude;
+	int m_latitude;
+};
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file ThreadPool.cpp
+ *
+ * @brief Fixed set of worker threads running jobs for the CPU side systems.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+	m_workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; ++i)
+		m_workers.emplace_back([this]() { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_taskAvailable.notify_all();
+	for (std::thread& worker : m_workers)
+		worker.join();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& job)
+{
+	if (count == 0)
+		return;
+
+	// Indices are handed out one at a time so uneven jobs balance themselves
+	std::atomic<size_t> next(0);
+	auto run = [&]() {
+		for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+			job(i);
+	};
+
+	const size_t helpers = std::min<size_t>(m_workers.size(), count - 1);
+	size_t running = helpers;
+	std::mutex mutex;
+	std::condition_variable finished;
+
+	for (size_t h = 0; h < helpers; ++h)
+	{
+		submit([&]() {
+			run();
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--running == 0)
+				finished.notify_all();
+		});
+	}
+
+	run();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [&]() { return running == 0; });
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+		++m_pending;
+	}
+	m_taskAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_tasksDone.wait(lock, [this]() { return m_pending == 0; });
+}
+
+ThreadPool& ThreadPool::global()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+			if (m_tasks.empty())
+				return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+
+		task();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_pending == 0)
+			m_tasksDone.notify_all();
+	}
+}
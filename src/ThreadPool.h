@@ -0,0 +1,57 @@
+#pragma once
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+/**
+ * @file ThreadPool.h
+ *
+ * @brief Fixed set of worker threads running jobs for the CPU side systems.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+	// 0 uses one thread per hardware core, minus the calling one
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	inline unsigned int threadCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+	// Run job(index) for every index in [0, count) and wait for all of them.
+	// The calling thread takes part in the work. Must not be called from a job.
+	void parallelFor(size_t count, const std::function<void(size_t)>& job);
+
+	// Queue an independent task
+	void submit(std::function<void()> task);
+	// Wait until every submitted task is done
+	void wait();
+
+	// Pool shared by the systems that do not need their own
+	static ThreadPool& global();
+
+private:
+	void workerLoop();
+
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_taskAvailable;
+	std::condition_variable m_tasksDone;
+	size_t m_pending = 0;
+	bool m_stopping = false;
+};
+#endif
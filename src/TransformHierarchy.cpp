@@ -0,0 +1,418 @@
+/**
+ * @file TransformHierarchy.cpp
+ *
+ * @brief Parent/child transforms whose world matrices are updated lazily.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include "TransformHierarchy.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <type_traits>
+
+static const uint32_t InvalidIndex = ~0u;
+
+// Above this ratio of dirty nodes, a single linear pass over the whole
+// hierarchy is cheaper than walking each dirty subtree.
+static const size_t LinearUpdateRatio = 8;
+
+enum DirtyState : uint8_t { Clean = 0, Dirty = 1, Updated = 2 };
+
+TransformHierarchy::TransformHierarchy()
+{
+}
+
+void TransformHierarchy::reserve(size_t count)
+{
+	m_parent.reserve(count);
+	m_parentSlot.reserve(count);
+	m_firstChild.reserve(count);
+	m_childCount.reserve(count);
+	m_localPosition.reserve(count);
+	m_localRotation.reserve(count);
+	m_localScale.reserve(count);
+	m_world.reserve(count);
+	m_userData.reserve(count);
+	m_dirty.reserve(count);
+	m_denseToSlot.reserve(count);
+	m_slotToDense.reserve(count);
+	m_slotGeneration.reserve(count);
+	m_changed.reserve(count);
+	m_queue.reserve(count);
+}
+
+TransformHandle TransformHierarchy::create(TransformHandle parent)
+{
+	uint32_t parentSlot = InvalidIndex;
+	if (parent != TransformHandle())
+	{
+		if (!isValid(parent)) {
+			std::cerr << "Invalid parent given to the transform hierarchy" << std::endl;
+			return TransformHandle();
+		}
+		parentSlot = parent.slot;
+	}
+
+	const uint32_t dense = static_cast<uint32_t>(m_denseToSlot.size());
+
+	uint32_t slot;
+	if (m_freeSlot != InvalidIndex)
+	{
+		slot = m_freeSlot;
+		m_freeSlot = m_slotToDense[slot];
+		m_slotToDense[slot] = dense;
+	}
+	else
+	{
+		slot = static_cast<uint32_t>(m_slotToDense.size());
+		m_slotToDense.push_back(dense);
+		m_slotGeneration.push_back(0);
+	}
+
+	m_parent.push_back(InvalidIndex);
+	m_parentSlot.push_back(parentSlot);
+	m_firstChild.push_back(0);
+	m_childCount.push_back(0);
+	m_localPosition.push_back(glm::vec3(0.0f));
+	m_localRotation.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	m_localScale.push_back(glm::vec3(1.0f));
+	m_world.push_back(glm::mat4(1.0f));
+	m_userData.push_back(NoUserData);
+	m_dirty.push_back(Clean);
+	m_denseToSlot.push_back(slot);
+	++m_liveCount;
+
+	m_layoutDirty = true;
+
+	TransformHandle handle = handleOfSlot(slot);
+	markDirty(handle);
+	return handle;
+}
+
+bool TransformHierarchy::destroy(TransformHandle handle)
+{
+	if (!isValid(handle))
+		return false;
+
+	// Child ranges are needed to find the subtree
+	if (m_layoutDirty)
+		relayout();
+
+	m_queue.clear();
+	m_queue.push_back(denseIndex(handle));
+	for (size_t i = 0; i < m_queue.size(); ++i)
+	{
+		const uint32_t node = m_queue[i];
+		for (uint32_t c = 0; c < m_childCount[node]; ++c)
+			m_queue.push_back(m_firstChild[node] + c);
+
+		const uint32_t slot = m_denseToSlot[node];
+		++m_slotGeneration[slot];
+		m_slotToDense[slot] = m_freeSlot;
+		m_freeSlot = slot;
+		m_denseToSlot[node] = InvalidIndex;
+		--m_liveCount;
+	}
+
+	// The dead nodes are removed from the arrays by the next layout
+	m_layoutDirty = true;
+	return true;
+}
+
+bool TransformHierarchy::isValid(TransformHandle handle) const
+{
+	return denseIndex(handle) != InvalidIndex;
+}
+
+void TransformHierarchy::setParent(TransformHandle handle, TransformHandle parent)
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+
+	uint32_t parentSlot = InvalidIndex;
+	if (parent != TransformHandle())
+	{
+		assert(isValid(parent));
+
+		// Refuse to create a cycle
+		for (uint32_t slot = parent.slot; slot != InvalidIndex; slot = m_parentSlot[m_slotToDense[slot]])
+		{
+			if (slot == handle.slot) {
+				std::cerr << "A transform cannot be parented to one of its descendants" << std::endl;
+				return;
+			}
+		}
+		parentSlot = parent.slot;
+	}
+
+	if (m_parentSlot[dense] == parentSlot)
+		return;
+
+	m_parentSlot[dense] = parentSlot;
+	m_layoutDirty = true;
+	markDirty(handle);
+}
+
+TransformHandle TransformHierarchy::parent(TransformHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	if (m_parentSlot[dense] == InvalidIndex)
+		return TransformHandle();
+	return handleOfSlot(m_parentSlot[dense]);
+}
+
+void TransformHierarchy::setLocalPosition(TransformHandle handle, const glm::vec3& position)
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	m_localPosition[dense] = position;
+	markDirty(handle);
+}
+
+void TransformHierarchy::setLocalRotation(TransformHandle handle, const glm::quat& rotation)
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	m_localRotation[dense] = rotation;
+	markDirty(handle);
+}
+
+void TransformHierarchy::setLocalScale(TransformHandle handle, const glm::vec3& scale)
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	m_localScale[dense] = scale;
+	markDirty(handle);
+}
+
+glm::vec3 TransformHierarchy::localPosition(TransformHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	return m_localPosition[dense];
+}
+
+glm::quat TransformHierarchy::localRotation(TransformHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	return m_localRotation[dense];
+}
+
+glm::vec3 TransformHierarchy::localScale(TransformHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	return m_localScale[dense];
+}
+
+const glm::mat4& TransformHierarchy::worldMatrix(TransformHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	return m_world[dense];
+}
+
+void TransformHierarchy::setUserData(TransformHandle handle, uint32_t userData)
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	m_userData[dense] = userData;
+}
+
+uint32_t TransformHierarchy::userData(TransformHandle handle) const
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	return m_userData[dense];
+}
+
+void TransformHierarchy::markDirty(TransformHandle handle)
+{
+	const uint32_t dense = denseIndex(handle);
+	assert(dense != InvalidIndex);
+	if (m_dirty[dense] == Clean)
+	{
+		m_dirty[dense] = Dirty;
+		m_dirtyNodes.push_back(handle);
+	}
+}
+
+void TransformHierarchy::update()
+{
+	if (m_layoutDirty)
+		relayout();
+
+	m_changed.clear();
+	if (m_dirtyNodes.empty())
+		return;
+
+	if (m_dirtyNodes.size() * LinearUpdateRatio >= m_liveCount)
+		updateLinear();
+	else
+		updateSparse();
+
+	m_dirtyNodes.clear();
+}
+
+void TransformHierarchy::updateSparse()
+{
+	// Sorting the dirty nodes by index sorts them by level: a dirty ancestor
+	// is always handled before its dirty descendants, which are then skipped.
+	m_dirtyIndices.clear();
+	for (const TransformHandle& handle : m_dirtyNodes)
+	{
+		const uint32_t dense = denseIndex(handle);
+		if (dense != InvalidIndex)
+			m_dirtyIndices.push_back(dense);
+	}
+	std::sort(m_dirtyIndices.begin(), m_dirtyIndices.end());
+
+	// The queue keeps every visited node so their state can be reset after
+	m_queue.clear();
+	for (uint32_t root : m_dirtyIndices)
+	{
+		if (m_dirty[root] == Updated)
+			continue;
+
+		size_t i = m_queue.size();
+		m_queue.push_back(root);
+		for (; i < m_queue.size(); ++i)
+		{
+			const uint32_t node = m_queue[i];
+			computeWorld(node);
+			m_dirty[node] = Updated;
+			m_changed.push_back(handleOfSlot(m_denseToSlot[node]));
+
+			for (uint32_t c = 0; c < m_childCount[node]; ++c)
+				m_queue.push_back(m_firstChild[node] + c);
+		}
+	}
+
+	for (uint32_t node : m_queue)
+		m_dirty[node] = Clean;
+}
+
+void TransformHierarchy::updateLinear()
+{
+	// Parents come before their children: propagating the flag while walking
+	// the array marks every descendant of a dirty node.
+	const size_t count = m_denseToSlot.size();
+	for (size_t node = 0; node < count; ++node)
+	{
+		const uint32_t parent = m_parent[node];
+		if (parent != InvalidIndex && m_dirty[parent] != Clean)
+			m_dirty[node] = Dirty;
+
+		if (m_dirty[node] != Clean)
+		{
+			computeWorld(static_cast<uint32_t>(node));
+			m_changed.push_back(handleOfSlot(m_denseToSlot[node]));
+		}
+	}
+
+	std::fill(m_dirty.begin(), m_dirty.end(), static_cast<uint8_t>(Clean));
+}
+
+void TransformHierarchy::computeWorld(uint32_t index)
+{
+	glm::mat4 local = glm::translate(glm::mat4(1.0f), m_localPosition[index]);
+	local *= glm::mat4_cast(m_localRotation[index]);
+	local = glm::scale(local, m_localScale[index]);
+
+	const uint32_t parent = m_parent[index];
+	m_world[index] = parent != InvalidIndex ? m_world[parent] * local : local;
+}
+
+void TransformHierarchy::relayout()
+{
+	const uint32_t count = static_cast<uint32_t>(m_denseToSlot.size());
+
+	// Gather the children of every live node (counting sort on the parent)
+	std::vector<uint32_t> childOffsets(count + 1, 0);
+	std::vector<uint32_t> roots;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (m_denseToSlot[i] == InvalidIndex)
+			continue;
+		if (m_parentSlot[i] == InvalidIndex)
+			roots.push_back(i);
+		else
+			++childOffsets[m_slotToDense[m_parentSlot[i]] + 1];
+	}
+	for (uint32_t i = 0; i < count; ++i)
+		childOffsets[i + 1] += childOffsets[i];
+
+	std::vector<uint32_t> children(childOffsets[count]);
+	std::vector<uint32_t> fill(childOffsets.begin(), childOffsets.end() - 1);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (m_denseToSlot[i] != InvalidIndex && m_parentSlot[i] != InvalidIndex)
+			children[fill[m_slotToDense[m_parentSlot[i]]]++] = i;
+	}
+
+	// Breadth first traversal: gives the new order of the nodes
+	std::vector<uint32_t> order = roots;
+	std::vector<uint32_t> firstChild(m_liveCount);
+	std::vector<uint32_t> childCount(m_liveCount);
+	order.reserve(m_liveCount);
+	for (size_t k = 0; k < order.size(); ++k)
+	{
+		const uint32_t node = order[k];
+		firstChild[k] = static_cast<uint32_t>(order.size());
+		childCount[k] = childOffsets[node + 1] - childOffsets[node];
+		order.insert(order.end(), children.begin() + childOffsets[node], children.begin() + childOffsets[node + 1]);
+	}
+	assert(order.size() == m_liveCount);
+
+	// Apply the permutation to every array
+	auto permute = [&order](auto& values) {
+		typename std::remove_reference<decltype(values)>::type sorted;
+		sorted.reserve(values.capacity());
+		for (uint32_t node : order)
+			sorted.push_back(values[node]);
+		values.swap(sorted);
+	};
+	permute(m_parentSlot);
+	permute(m_localPosition);
+	permute(m_localRotation);
+	permute(m_localScale);
+	permute(m_world);
+	permute(m_userData);
+	permute(m_dirty);
+	permute(m_denseToSlot);
+	m_firstChild.swap(firstChild);
+	m_childCount.swap(childCount);
+
+	for (uint32_t i = 0; i < m_denseToSlot.size(); ++i)
+		m_slotToDense[m_denseToSlot[i]] = i;
+
+	m_parent.resize(m_denseToSlot.size());
+	for (uint32_t i = 0; i < m_denseToSlot.size(); ++i)
+		m_parent[i] = m_parentSlot[i] != InvalidIndex ? m_slotToDense[m_parentSlot[i]] : InvalidIndex;
+
+	m_layoutDirty = false;
+}
+
+TransformHandle TransformHierarchy::handleOfSlot(uint32_t slot) const
+{
+	TransformHandle handle;
+	handle.slot = slot;
+	handle.generation = m_slotGeneration[slot];
+	return handle;
+}
+
+uint32_t TransformHierarchy::denseIndex(TransformHandle handle) const
+{
+	if (handle.slot >= m_slotGeneration.size() || m_slotGeneration[handle.slot] != handle.generation)
+		return InvalidIndex;
+	return m_slotToDense[handle.slot];
+}
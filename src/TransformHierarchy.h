@@ -0,0 +1,112 @@
+#pragma once
+#ifndef TRANSFORMHIERARCHY_H
+#define TRANSFORMHIERARCHY_H
+
+/**
+ * @file TransformHierarchy.h
+ *
+ * @brief Parent/child transforms whose world matrices are updated lazily.
+ *
+ * Nodes are stored breadth first (sorted by level) so that a parent always
+ * comes before its children and the children of a node are contiguous.
+ * Changing a local transform only marks the node dirty; update() recomputes
+ * the world matrices of the dirty subtrees and nothing else.
+ *
+ * Martin Johnson
+ * Billy-Joe Lacasse
+ * William Lebel
+ */
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct TransformHandle {
+	uint32_t slot = ~0u;
+	uint32_t generation = 0;
+
+	inline bool operator==(const TransformHandle& other) const { return slot == other.slot && generation == other.generation; }
+	inline bool operator!=(const TransformHandle& other) const { return !(*this == other); }
+};
+
+class TransformHierarchy {
+public:
+	static constexpr uint32_t NoUserData = ~0u;
+
+	TransformHierarchy();
+
+	void reserve(size_t count);
+
+	// Create a node, as a root when the parent is invalid
+	TransformHandle create(TransformHandle parent = TransformHandle());
+	// Destroy a node and all of its descendants
+	bool destroy(TransformHandle handle);
+	bool isValid(TransformHandle handle) const;
+
+	inline size_t size() const { return m_liveCount; }
+
+	void setParent(TransformHandle handle, TransformHandle parent);
+	TransformHandle parent(TransformHandle handle) const;
+
+	void setLocalPosition(TransformHandle handle, const glm::vec3& position);
+	void setLocalRotation(TransformHandle handle, const glm::quat& rotation);
+	void setLocalScale(TransformHandle handle, const glm::vec3& scale);
+	glm::vec3 localPosition(TransformHandle handle) const;
+	glm::quat localRotation(TransformHandle handle) const;
+	glm::vec3 localScale(TransformHandle handle) const;
+
+	// World matrix computed by the last update()
+	const glm::mat4& worldMatrix(TransformHandle handle) const;
+
+	// Free value attached to the node (e.g. index of the object it moves)
+	void setUserData(TransformHandle handle, uint32_t userData);
+	uint32_t userData(TransformHandle handle) const;
+
+	// Force the recomputation of a subtree on the next update
+	void markDirty(TransformHandle handle);
+
+	// Recompute the world matrices of the dirty subtrees
+	void update();
+	// Nodes whose world matrix was recomputed by the last update()
+	inline const std::vector<TransformHandle>& changedNodes() const { return m_changed; }
+
+private:
+	uint32_t denseIndex(TransformHandle handle) const;
+	TransformHandle handleOfSlot(uint32_t slot) const;
+
+	void relayout();
+	void updateSparse();
+	void updateLinear();
+	void computeWorld(uint32_t index);
+
+	// Node data, stored breadth first
+	std::vector<uint32_t> m_parent;       // Dense index of the parent (or invalid)
+	std::vector<uint32_t> m_parentSlot;   // Slot of the parent, stable across layouts
+	std::vector<uint32_t> m_firstChild;
+	std::vector<uint32_t> m_childCount;
+	std::vector<glm::vec3> m_localPosition;
+	std::vector<glm::quat> m_localRotation;
+	std::vector<glm::vec3> m_localScale;
+	std::vector<glm::mat4> m_world;
+	std::vector<uint32_t> m_userData;
+	std::vector<uint8_t> m_dirty;
+	std::vector<uint32_t> m_denseToSlot;  // Invalid once the node is destroyed
+
+	// Handle indirection: slot -> dense index (or next free slot when unused)
+	std::vector<uint32_t> m_slotToDense;
+	std::vector<uint32_t> m_slotGeneration;
+	uint32_t m_freeSlot = ~0u;
+	size_t m_liveCount = 0;
+
+	// Structural changes (creation, destruction, reparenting) are applied
+	// all at once on the next update.
+	bool m_layoutDirty = false;
+
+	std::vector<TransformHandle> m_dirtyNodes;
+	std::vector<uint32_t> m_dirtyIndices;
+	std::vector<uint32_t> m_queue;
+	std::vector<TransformHandle> m_changed;
+};
+#endif
@@ -1,11 +1,25 @@
-#version 400 core
+#version 450 core
 
-uniform vec3 uColor;
+// Parameters of the material instances (see MaterialTable)
+struct MaterialParameters
+{
+	vec4 ambiant;
+	vec4 diffuse;
+	vec3 specular;
+	float specularExponent;
+};
+
+layout(std430) readonly buffer Materials
+{
+	MaterialParameters materials[];
+};
+
+flat in uint fMaterial;
 
 out vec4 fColor;
 
 void
 main()
 {
-    fColor = vec4(uColor, 1);
+    fColor = vec4(materials[fMaterial].diffuse.rgb, 1);
 }
@@ -1,11 +1,23 @@
-#version 400 core
-in vec4 vPosition;
+#version 450 core
+layout(location = 0) in vec4 vPosition;
 
-uniform mat4 view;
-uniform mat4 projection;
+// Per instance (see InstanceBuffer)
+layout(location = 2) in mat4 model;
+layout(location = 6) in uint vMaterial;
+
+layout(std140) uniform Frame
+{
+	mat4 projection;
+	mat4 view;
+	vec3 viewPos;
+};
+
+flat out uint fMaterial;
 
 void main()
 {
-     gl_Position = projection * view * vec4(vPosition.xy, -vPosition.z, 1);
+     vec4 worldPosition = model * vPosition;
+     fMaterial = vMaterial;
+     gl_Position = projection * view * vec4(worldPosition.xy, -worldPosition.z, 1);
 }
 
@@ -1,10 +1,18 @@
-#version 400 core
+#version 450 core
 
-uniform vec3 uAmbiantColor;
-uniform vec3 uDiffuseColor;
-uniform vec3 uSpecularColor;
-uniform float uSpecularExponent;
-uniform bool phong;
+// Parameters of the material instances (see MaterialTable)
+struct MaterialParameters
+{
+	vec4 ambiant;
+	vec4 diffuse;
+	vec3 specular;
+	float specularExponent;
+};
+
+layout(std430) readonly buffer Materials
+{
+	MaterialParameters materials[];
+};
 
 uniform vec3 uLightPosition;
 uniform vec4 uLightColor;
@@ -13,6 +21,7 @@ uniform vec4 uLightColor;
 in vec3 fNormal;
 in vec3 fEyeVector;
 in vec3 fPosition;
+flat in uint fMaterial;
 
 out vec4 fColor;
 
@@ -24,6 +33,7 @@ float distanceSquared(vec3 left, vec3 right)
 
 void main()
 {
+	MaterialParameters material = materials[fMaterial];
 	vec3 lightPosition = vec3(uLightPosition.xy, uLightPosition.z);
 
     vec3 lightDirection = normalize(lightPosition - fPosition);
@@ -34,23 +44,21 @@ void main()
     float diffuse = max(0, dot(nfNormal, lightDirection));
 	float specular = 0;
 
-	if (diffuse > 0 && uSpecularExponent > 0) {
-		if (phong)
-		{
-			vec3 reflectedVector = reflect(-lightDirection, nfNormal);
-			specular = pow(max(0.0, dot(nfEyeVector, reflectedVector)),uSpecularExponent);
-		}
-		else
-		{
-			vec3 halfwayDir = normalize(lightDirection + nfEyeVector);
-			specular = pow(max(dot(nfNormal,halfwayDir),0.0),uSpecularExponent);
-		}
+	if (diffuse > 0 && material.specularExponent > 0) {
+		// PHONG or BLINN is defined by the material (see Material::Feature)
+#ifdef BLINN
+		vec3 halfwayDir = normalize(lightDirection + nfEyeVector);
+		specular = pow(max(dot(nfNormal,halfwayDir),0.0),material.specularExponent);
+#else
+		vec3 reflectedVector = reflect(-lightDirection, nfNormal);
+		specular = pow(max(0.0, dot(nfEyeVector, reflectedVector)),material.specularExponent);
+#endif
 
 	}
 
-	vec4 ambiantContribution = vec4(uAmbiantColor, 1);
-	vec4 diffuseContribution = vec4(uDiffuseColor, 1) * diffuse;
-	vec4 specularContribution = vec4(uSpecularColor, 1) * specular;
+	vec4 ambiantContribution = vec4(material.ambiant.rgb, 1);
+	vec4 diffuseContribution = vec4(material.diffuse.rgb, 1) * diffuse;
+	vec4 specularContribution = vec4(material.specular, 1) * specular;
 
 	fColor = ambiantContribution + uLightColor * (diffuseContribution + specularContribution) * (1 / distanceSquared(fPosition, lightPosition));
 }
@@ -1,24 +1,35 @@
-#version 400 core
+#version 450 core
 
-uniform mat4 view;
-uniform vec3 viewPos;
-uniform mat4 projection;
+layout(std140) uniform Frame
+{
+	mat4 projection;
+	mat4 view;
+	vec3 viewPos;
+};
+
+// Same locations in every variant, the vertex arrays are shared
+layout(location = 0) in vec4 vPosition;
+layout(location = 1) in vec3 vNormal;
 
-in vec4 vPosition;
-in vec3 vNormal;
+// Per instance (see InstanceBuffer)
+layout(location = 2) in mat4 model;
+layout(location = 6) in uint vMaterial;
 
 out vec3 fNormal;
 out vec3 fEyeVector;
 out vec3 fPosition;
+flat out uint fMaterial;
 
 void
 main()
 {
-	 fNormal = vNormal;
-	 fPosition = vPosition.xyz;
+	 vec4 worldPosition = model * vPosition;
+	 fNormal = mat3(model) * vNormal;
+	 fPosition = worldPosition.xyz;
+	 fMaterial = vMaterial;
 	 vec3 ajustedViewPos = viewPos - fPosition;
 	 fEyeVector = vec3(ajustedViewPos.xy,-ajustedViewPos.z);
 
-     gl_Position = projection * view * vec4(vPosition.xy, -vPosition.z, 1);
+     gl_Position = projection * view * vec4(worldPosition.xy, -worldPosition.z, 1);
 }
 